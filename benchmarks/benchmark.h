@@ -0,0 +1,18 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace sqlite3_wrapper_benchmark
+{
+    template<class F>
+    void run(const std::string &name, size_t operations, F &&f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::printf("%-40s %12.0f ops/s %10.3f us/op\n", name.c_str(), operations / elapsed, elapsed * 1e6 / operations);
+    }
+}
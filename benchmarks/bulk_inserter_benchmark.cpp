@@ -0,0 +1,50 @@
+#include <sqlite3_wrapper/sqlite3_bulk_inserter.h>
+
+#include "benchmark.h"
+
+#include <random>
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+int main()
+{
+    const std::string filename = "bulk_inserter_benchmark.db";
+    const size_t rows = 1000000;
+    const size_t batch_size = 10000;
+
+    for (bool sorted : {false, true})
+    {
+        std::remove(filename.c_str());
+        std::remove((filename + "-wal").c_str());
+        std::remove((filename + "-shm").c_str());
+
+        sqlite::db db(filename);
+        db.execute("PRAGMA journal_mode = WAL").fetch();
+        db.execute("PRAGMA synchronous = NORMAL");
+        db.execute("PRAGMA cache_size = -2000");
+        db.execute("CREATE TABLE items(id INTEGER PRIMARY KEY, uuid TEXT NOT NULL UNIQUE, value INTEGER)");
+
+        std::mt19937_64 random(42);
+        benchmark::run(sorted ? "random keys, sorted batches" : "random keys, unsorted batches", rows, [&]
+        {
+            sqlite::bulk_inserter<int64_t, std::string, int64_t> inserter(db, "INSERT OR REPLACE INTO items(id, uuid, value) VALUES (?, ?, ?)", batch_size);
+            if (sorted)
+            {
+                inserter.sort_by_key<0>();
+            }
+
+            for (size_t i = 0; i < rows; ++i)
+            {
+                auto id = static_cast<int64_t>(random() >> 1);
+                inserter.insert(id, std::to_string(id), static_cast<int64_t>(i));
+            }
+        });
+    }
+
+    std::remove(filename.c_str());
+    std::remove((filename + "-wal").c_str());
+    std::remove((filename + "-shm").c_str());
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <sqlite3_wrapper/sqlite3_counter_buffer.h>
+
+#include "benchmark.h"
+
+#include <vector>
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+namespace
+{
+    sqlite::db open(const std::string &filename)
+    {
+        sqlite::db db(filename, sqlite::threading_mode::MULTI_THREAD);
+        db.execute("PRAGMA journal_mode = WAL").fetch();
+        db.execute("PRAGMA synchronous = NORMAL");
+        db.execute("PRAGMA busy_timeout = 10000");
+
+        return db;
+    }
+}
+
+int main()
+{
+    const std::string filename = "counter_buffer_benchmark.db";
+    const size_t counters = 1000;
+    const size_t events = 20000;
+    const size_t buffered_events = 2000000;
+
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < counters; ++i)
+    {
+        keys.push_back("counter" + std::to_string(i));
+    }
+
+    {
+        auto db = open(filename);
+        db.execute("CREATE TABLE IF NOT EXISTS direct(key PRIMARY KEY NOT NULL, value INTEGER NOT NULL) WITHOUT ROWID");
+
+        benchmark::run("UPSERT transaction per event", events, [&]
+        {
+            auto statement = db.prepare("INSERT INTO direct(key, value) VALUES (?, 1) ON CONFLICT(key) DO UPDATE SET value = value + 1");
+            for (size_t i = 0; i < events; ++i)
+            {
+                statement.execute(keys[(i * 7919) % counters]);
+            }
+        });
+    }
+
+    benchmark::run("counter_buffer add, flush every 100ms", buffered_events, [&]
+    {
+        sqlite::counter_buffer<std::string> buffer(open(filename), "buffered", std::chrono::milliseconds(100));
+        for (size_t i = 0; i < buffered_events; ++i)
+        {
+            buffer.add(keys[(i * 7919) % counters]);
+        }
+    });
+
+    {
+        auto db = open(filename);
+        int64_t total = 0;
+        db.execute("SELECT SUM(value) FROM buffered").fetch(total);
+        std::printf("flushed total %lld of %zu\n", static_cast<long long>(total), buffered_events);
+    }
+
+    std::remove(filename.c_str());
+    std::remove((filename + "-wal").c_str());
+    std::remove((filename + "-shm").c_str());
+
+    return 0;
+}
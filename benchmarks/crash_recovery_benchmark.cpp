@@ -0,0 +1,212 @@
+#include <sqlite3_wrapper/sqlite3_fault_injection.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace sqlite = sqlite3_wrapper;
+
+// Crash-consistency of journal/synchronous/checkpoint profiles: a workload of acknowledged transactions runs through
+// power_loss_vfs, which fails at a write point and keeps a random subset of the unsynced writes, some of them torn,
+// then the database is reopened.
+// Usage: crash_recovery_benchmark [--trials N] [--transactions N] [--seed N] [--persist P] [--torn P] [--db path]
+// Prints throughput without crashes, lost acknowledged transactions, corrupt reopens and recovery time per profile.
+namespace
+{
+    struct profile
+    {
+        const char *name;
+        const char *journal_mode;
+        const char *synchronous;
+        int autocheckpoint;
+    };
+
+    const profile profiles[] = {
+        {"wal_off", "WAL", "OFF", 1000},
+        {"wal_off_checkpoint_100", "WAL", "OFF", 100},
+        {"wal_normal", "WAL", "NORMAL", 1000},
+        {"wal_normal_checkpoint_100", "WAL", "NORMAL", 100},
+        {"wal_full", "WAL", "FULL", 1000},
+        {"delete_off", "DELETE", "OFF", 0},
+        {"delete_normal", "DELETE", "NORMAL", 0},
+        {"delete_full", "DELETE", "FULL", 0},
+    };
+
+    const int rows_per_transaction = 5;
+
+    struct options
+    {
+        unsigned int trials = 20;
+        unsigned int transactions = 200;
+        uint64_t seed = 42;
+        sqlite::persistence_model model;
+        std::string filename = "crash_recovery_benchmark.db";
+    };
+
+    void remove_database(const std::string &filename)
+    {
+        for (auto suffix : {"", "-wal", "-shm", "-journal"})
+        {
+            std::remove((filename + suffix).c_str());
+        }
+    }
+
+    // Runs the workload until it completes or the VFS crashes, returns the number of acknowledged transactions
+    unsigned int run_workload(const options &options, const profile &profile, sqlite::power_loss_vfs &vfs, uint64_t crash_after)
+    {
+        sqlite::db db(options.filename, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, vfs.name().c_str());
+        db.execute(std::string("PRAGMA journal_mode = ") + profile.journal_mode).fetch();
+        db.execute(std::string("PRAGMA synchronous = ") + profile.synchronous);
+        db.execute("PRAGMA wal_autocheckpoint = " + std::to_string(profile.autocheckpoint)).fetch();
+        db.execute("CREATE TABLE items(id INTEGER PRIMARY KEY, payload TEXT NOT NULL)");
+        vfs.settle();
+        vfs.crash_after(crash_after);
+
+        unsigned int acknowledged = 0;
+        try
+        {
+            auto statement = db.prepare("INSERT INTO items(id, payload) VALUES (?, ?)");
+            for (unsigned int t = 0; t < options.transactions; ++t)
+            {
+                db.begin();
+                for (int r = 0; r < rows_per_transaction; ++r)
+                {
+                    statement.execute(static_cast<int64_t>(t * rows_per_transaction + r), std::string(300, 'a' + r));
+                }
+                db.commit();
+                ++acknowledged;
+            }
+        }
+        catch (const sqlite::exception &)
+        {
+            if (!vfs.crashed())
+            {
+                throw;
+            }
+        }
+
+        return acknowledged;
+    }
+
+    struct trial
+    {
+        unsigned int acknowledged = 0;
+        int64_t durable = 0;
+        bool corrupt = false;
+        double recovery_ms = 0;
+    };
+
+    // Reopens after the power loss with the default VFS, timing the first query which runs WAL recovery or
+    // rolls back a hot journal
+    trial recover(const options &options, unsigned int acknowledged)
+    {
+        trial result;
+        result.acknowledged = acknowledged;
+        try
+        {
+            auto start = std::chrono::steady_clock::now();
+            sqlite::db db(options.filename);
+            int64_t rows = 0;
+            db.execute("SELECT count(*) FROM items").fetch(rows);
+            result.recovery_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::string integrity;
+            db.execute("PRAGMA integrity_check").fetch(integrity);
+            result.durable = rows / rows_per_transaction;
+            result.corrupt = integrity != "ok" || rows % rows_per_transaction != 0 || result.durable > acknowledged + 1;
+        }
+        catch (const sqlite::exception &)
+        {
+            result.corrupt = true;
+        }
+
+        return result;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--trials")
+        {
+            options.trials = static_cast<unsigned int>(std::max(1, std::atoi(argv[i + 1])));
+        }
+        else if (arg == "--transactions")
+        {
+            options.transactions = static_cast<unsigned int>(std::max(1, std::atoi(argv[i + 1])));
+        }
+        else if (arg == "--seed")
+        {
+            options.seed = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (arg == "--persist")
+        {
+            options.model.persist = std::atof(argv[i + 1]);
+        }
+        else if (arg == "--torn")
+        {
+            options.model.torn = std::atof(argv[i + 1]);
+        }
+        else if (arg == "--db")
+        {
+            options.filename = argv[i + 1];
+        }
+    }
+
+    sqlite::power_loss_vfs vfs("power_loss", nullptr, options.model, options.seed);
+    std::mt19937_64 random(options.seed);
+
+    std::printf("%-28s %10s %8s %8s %12s %10s %8s %14s %14s\n", "profile", "txn/s", "writes", "trials", "lost avg", "lost max", "corrupt",
+        "recovery p50", "recovery max");
+    for (const auto &profile : profiles)
+    {
+        // a run without crash gives throughput and the range of write points
+        remove_database(options.filename);
+        auto start = std::chrono::steady_clock::now();
+        auto writes_before = vfs.writes();
+        run_workload(options, profile, vfs, 0);
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        auto writes = vfs.writes() - writes_before;
+
+        std::vector<trial> trials;
+        for (unsigned int i = 0; i < options.trials; ++i)
+        {
+            remove_database(options.filename);
+            auto crash_after = 1 + writes * i / options.trials + random() % std::max<uint64_t>(1, writes / options.trials);
+            auto acknowledged = run_workload(options, profile, vfs, crash_after);
+            vfs.power_loss();
+            trials.push_back(recover(options, acknowledged));
+        }
+
+        double lost_total = 0;
+        int64_t lost_max = 0;
+        unsigned int corrupt = 0;
+        std::vector<double> recovery;
+        for (const auto &trial : trials)
+        {
+            if (trial.corrupt)
+            {
+                ++corrupt;
+                continue;
+            }
+            auto lost = std::max<int64_t>(0, static_cast<int64_t>(trial.acknowledged) - trial.durable);
+            lost_total += lost;
+            lost_max = std::max(lost_max, lost);
+            recovery.push_back(trial.recovery_ms);
+        }
+        std::sort(recovery.begin(), recovery.end());
+
+        auto valid = trials.size() - corrupt;
+        std::printf("%-28s %10.0f %8llu %8zu %12.2f %10lld %8u %11.3f ms %11.3f ms\n", profile.name, options.transactions / elapsed,
+            static_cast<unsigned long long>(writes), trials.size(), valid ? lost_total / valid : 0.0, static_cast<long long>(lost_max), corrupt,
+            recovery.empty() ? 0.0 : recovery[recovery.size() / 2], recovery.empty() ? 0.0 : recovery.back());
+    }
+
+    remove_database(options.filename);
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <sqlite3_wrapper/sqlite3_event_log.h>
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+namespace
+{
+    sqlite::db open(const std::string &filename)
+    {
+        sqlite::db db(filename);
+        db.execute("PRAGMA journal_mode = WAL").fetch();
+        db.execute("PRAGMA synchronous = NORMAL");
+        db.execute("PRAGMA busy_timeout = 10000");
+
+        return db;
+    }
+
+    int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+int main()
+{
+    const std::string filename = "event_log_benchmark.db";
+    const size_t events = 2000;
+
+    auto writer_db = open(filename);
+    sqlite::event_log log(writer_db, "events");
+
+    benchmark::run("append (batches of 1000)", 100000, [&]
+    {
+        std::vector<std::string> payloads(1000, std::string(64, 'x'));
+        for (size_t i = 0; i < 100; ++i)
+        {
+            log.append(payloads);
+        }
+    });
+
+    // payload carries append time, readers measure commit to delivery latency
+    std::vector<int64_t> latencies;
+    std::thread reader([&, after = log.last_seq()]
+    {
+        auto reader_db = open(filename);
+        auto tail = log.tail(reader_db, after);
+
+        std::vector<sqlite::event> batch;
+        while (latencies.size() < events)
+        {
+            auto count = tail.read(100, batch, std::chrono::milliseconds(1000));
+            auto received = now_ns();
+            for (size_t i = 0; i < count; ++i)
+            {
+                latencies.push_back(received - std::stoll(batch[i].payload));
+            }
+        }
+    });
+
+    for (size_t i = 0; i < events; ++i)
+    {
+        log.append(std::to_string(now_ns()));
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    reader.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("tail latency p50 %.1f us, p99 %.1f us\n", latencies[latencies.size() / 2] / 1e3, latencies[latencies.size() * 99 / 100] / 1e3);
+
+    std::remove(filename.c_str());
+    std::remove((filename + "-wal").c_str());
+    std::remove((filename + "-shm").c_str());
+
+    return 0;
+}
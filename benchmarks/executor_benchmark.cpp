@@ -0,0 +1,106 @@
+#include <sqlite3_wrapper/sqlite3_executor.h>
+
+#include <cstdio>
+
+namespace sqlite = sqlite3_wrapper;
+
+// Latency of point lookups (class 0) submitted while full-table scans (class 1) saturate the workers,
+// with and without batch concurrency limits and cooperative yielding
+namespace
+{
+    const char *filename = "executor_benchmark.db";
+    const size_t rows = 300000;
+    const size_t workers = 2;
+    const size_t lookups = 200;
+
+    struct config
+    {
+        const char *name;
+        size_t batch_limit;
+        int progress_interval;
+    };
+
+    void run(const config &config)
+    {
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> scans{0};
+        std::function<void()> submit_scan;
+        // destroyed first, its destructor runs the queued scans
+        sqlite::query_executor executor([] { return sqlite::db(filename, sqlite::threading_mode::MULTI_THREAD); }, workers,
+            {workers, config.batch_limit}, config.progress_interval);
+
+        submit_scan = [&]
+        {
+            executor.submit(1, [&](sqlite::db &db)
+            {
+                int64_t total = 0;
+                db.execute("SELECT sum(length(payload)) FROM items").fetch(total);
+                ++scans;
+                if (!stop)
+                {
+                    submit_scan();
+                }
+            });
+        };
+        for (size_t i = 0; i < workers * 2; ++i)
+        {
+            submit_scan();
+        }
+
+        std::vector<double> latencies;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < lookups; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            auto submitted = std::chrono::steady_clock::now();
+            executor.submit(0, [i](sqlite::db &db)
+            {
+                std::string payload;
+                db.execute("SELECT payload FROM items WHERE id = ?", static_cast<int64_t>(i * 997 % rows + 1)).fetch(payload);
+                return payload.size();
+            }).get();
+            latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitted).count());
+        }
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stop = true;
+        std::sort(latencies.begin(), latencies.end());
+
+        std::printf("%-32s lookup p50 %8.3f ms  p99 %8.3f ms  max %8.3f ms  scans %6.1f/s  yielded %llu\n", config.name,
+            latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back(), scans / elapsed,
+            static_cast<unsigned long long>(executor.yielded(0)));
+    }
+}
+
+int main()
+{
+    std::remove(filename);
+    {
+        sqlite::db db(filename);
+        db.execute("PRAGMA journal_mode = WAL").fetch();
+        db.execute("CREATE TABLE items(id INTEGER PRIMARY KEY, payload TEXT NOT NULL)");
+        auto statement = db.prepare("INSERT INTO items(payload) VALUES (?)");
+        db.begin();
+        for (size_t i = 0; i < rows; ++i)
+        {
+            statement.execute(std::string(100, 'a' + i % 26));
+        }
+        db.commit();
+    }
+
+    const config configs[] = {
+        {"priority only", workers, 0},
+        {"batch limit", workers - 1, 0},
+        {"cooperative yield", workers, 1000},
+    };
+    for (const auto &config : configs)
+    {
+        run(config);
+    }
+
+    for (auto suffix : {"", "-wal", "-shm"})
+    {
+        std::remove((std::string(filename) + suffix).c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <sqlite3_wrapper/sqlite3_wrapper.h>
+
+#include "benchmark.h"
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+namespace
+{
+    void point_selects(const std::string &name, sqlite::db &db, size_t records, size_t operations)
+    {
+        benchmark::run(name, operations, [&]
+        {
+            auto statement = db.prepare("SELECT value FROM lookup WHERE id = ?");
+            std::string value;
+            for (size_t i = 0; i < operations; ++i)
+            {
+                statement.execute(static_cast<int64_t>((i * 7919) % records));
+                statement.fetch(value);
+                statement.reset();
+            }
+        });
+    }
+}
+
+int main()
+{
+    const std::string filename = "immutable_benchmark.db";
+    const size_t records = 100000;
+    const size_t operations = 1000000;
+
+    std::remove(filename.c_str());
+    {
+        sqlite::db db(filename);
+        db.execute("CREATE TABLE lookup(id INTEGER PRIMARY KEY, value TEXT)");
+
+        auto statement = db.prepare("INSERT INTO lookup(id, value) VALUES (?, ?)");
+        db.begin();
+        for (size_t i = 0; i < records; ++i)
+        {
+            statement.execute(static_cast<int64_t>(i), "value" + std::to_string(i));
+        }
+        db.commit();
+    }
+
+    {
+        sqlite::db db(filename, SQLITE_OPEN_READONLY);
+        point_selects("read-only", db, records, operations);
+    }
+
+    {
+        sqlite::db db(filename, sqlite::immutable_options());
+        point_selects("immutable, mmap", db, records, operations);
+    }
+
+    {
+        sqlite::immutable_options options;
+        options.in_memory = true;
+        sqlite::db db(filename, options);
+        point_selects("immutable, in memory", db, records, operations);
+    }
+
+    std::remove(filename.c_str());
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <sqlite3_wrapper/sqlite3_io_accounting.h>
+
+#include "benchmark.h"
+
+#include <random>
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+namespace
+{
+    void workload(sqlite::db &db, size_t operations)
+    {
+        auto insert_statement = db.prepare("INSERT INTO items(payload) VALUES (?)");
+        auto select_statement = db.prepare("SELECT payload FROM items WHERE id = ?");
+        auto scan_statement = db.prepare("SELECT count(*) FROM items WHERE payload LIKE 'b%'");
+
+        std::mt19937_64 random(11);
+        std::string payload;
+        for (size_t i = 0; i < operations; ++i)
+        {
+            if (i % 4 == 0)
+            {
+                insert_statement.execute(std::string(200, 'a' + i % 26));
+            }
+            else if (i % 1000 == 1)
+            {
+                int64_t count;
+                scan_statement.execute();
+                scan_statement.fetch(count);
+                scan_statement.reset();
+            }
+            else
+            {
+                select_statement.execute(static_cast<int64_t>(random() % (i / 4 + 1) + 1));
+                select_statement.fetch(payload);
+                select_statement.reset();
+            }
+        }
+    }
+
+    void run(const std::string &name, const std::string &filename, size_t operations, const char *vfs)
+    {
+        std::remove(filename.c_str());
+        std::remove((filename + "-wal").c_str());
+        std::remove((filename + "-shm").c_str());
+
+        sqlite::db db(filename, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, vfs);
+        db.execute("PRAGMA journal_mode = WAL").fetch();
+        db.execute("PRAGMA synchronous = NORMAL");
+        // a small page cache makes lookups read from the file
+        db.execute("PRAGMA cache_size = 16");
+        db.execute("CREATE TABLE items(id INTEGER PRIMARY KEY, payload TEXT NOT NULL)");
+
+        benchmark::run(name, operations, [&] { workload(db, operations); });
+    }
+}
+
+int main()
+{
+    const std::string filename = "io_accounting_benchmark.db";
+    const size_t operations = 100000;
+
+    run("default VFS", filename, operations, nullptr);
+    {
+        sqlite::io_accounting accounting;
+        run("io_accounting VFS", filename, operations, accounting.name().c_str());
+        std::printf("%s", accounting.report(5).c_str());
+    }
+
+    std::remove(filename.c_str());
+    std::remove((filename + "-wal").c_str());
+    std::remove((filename + "-shm").c_str());
+
+    return 0;
+}
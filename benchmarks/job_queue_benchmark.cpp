@@ -0,0 +1,102 @@
+#include <sqlite3_wrapper/sqlite3_job_queue.h>
+
+#include "benchmark.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+namespace
+{
+    sqlite::db open(const std::string &filename)
+    {
+        sqlite::db db(filename);
+        db.execute("PRAGMA journal_mode = WAL").fetch();
+        db.execute("PRAGMA synchronous = NORMAL");
+        db.execute("PRAGMA busy_timeout = 10000");
+
+        return db;
+    }
+}
+
+int main()
+{
+    const std::string filename = "job_queue_benchmark.db";
+    const size_t jobs = 200000;
+    const size_t claim_size = 16;
+
+    auto remove_database = [&]
+    {
+        std::remove(filename.c_str());
+        std::remove((filename + "-wal").c_str());
+        std::remove((filename + "-shm").c_str());
+    };
+
+    for (unsigned int threads : {1u, 2u, 4u, 8u})
+    {
+        remove_database();
+
+        {
+            auto db = open(filename);
+            sqlite::job_queue queue(db, "jobs");
+
+            benchmark::run("enqueue (batches of 1000)", jobs, [&]
+            {
+                std::vector<std::string> payloads(1000, std::string(64, 'x'));
+                for (size_t i = 0; i < jobs; i += payloads.size())
+                {
+                    queue.enqueue(payloads);
+                }
+            });
+        }
+
+        std::atomic<size_t> processed(0);
+        benchmark::run("claim + ack, " + std::to_string(threads) + " threads", jobs, [&]
+        {
+            std::vector<std::thread> workers;
+            for (unsigned int i = 0; i < threads; ++i)
+            {
+                workers.emplace_back([&]
+                {
+                    auto db = open(filename);
+                    sqlite::job_queue queue(db, "jobs");
+
+                    for (;;)
+                    {
+                        auto claimed = queue.claim(claim_size);
+                        if (claimed.empty())
+                        {
+                            break;
+                        }
+
+                        db.begin(sqlite::transaction_type::IMMEDIATE);
+                        for (const auto &job : claimed)
+                        {
+                            queue.ack(job);
+                        }
+                        db.commit();
+
+                        processed += claimed.size();
+                    }
+                });
+            }
+
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+        });
+
+        if (processed != jobs)
+        {
+            std::printf("processed %zu of %zu jobs\n", processed.load(), jobs);
+            return 1;
+        }
+    }
+
+    remove_database();
+    return 0;
+}
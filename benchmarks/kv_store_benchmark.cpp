@@ -0,0 +1,101 @@
+#include <sqlite3_wrapper/sqlite3_kv_store.h>
+
+#include "benchmark.h"
+
+#include <random>
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+int main()
+{
+    const size_t records = 100000;
+    const size_t operations = 200000;
+
+    sqlite::db db(":memory:");
+    sqlite::kv_store<int64_t, std::string> store(db, "kv");
+    sqlite::kv_store<int64_t, std::string> cached_store(db, "kv", 10000);
+
+    db.begin();
+    for (size_t i = 0; i < records; ++i)
+    {
+        store.put(static_cast<int64_t>(i), "value" + std::to_string(i));
+    }
+    db.commit();
+
+    std::mt19937_64 random(42);
+    std::vector<int64_t> keys(operations);
+    for (auto &key : keys)
+    {
+        key = static_cast<int64_t>(random() % (records / 10));
+    }
+
+    benchmark::run("raw prepare per get", operations, [&]
+    {
+        std::string value;
+        for (auto key : keys)
+        {
+            auto statement = db.execute("SELECT value FROM kv WHERE key = ?", key);
+            statement.fetch(value);
+        }
+    });
+
+    benchmark::run("raw cached statement get", operations, [&]
+    {
+        auto statement = db.prepare("SELECT value FROM kv WHERE key = ?");
+        std::string value;
+        for (auto key : keys)
+        {
+            statement.execute(key);
+            statement.fetch(value);
+        }
+    });
+
+    benchmark::run("kv_store get", operations, [&]
+    {
+        std::string value;
+        for (auto key : keys)
+        {
+            store.get(key, value);
+        }
+    });
+
+    benchmark::run("kv_store get with lru cache", operations, [&]
+    {
+        std::string value;
+        for (auto key : keys)
+        {
+            cached_store.get(key, value);
+        }
+    });
+
+    benchmark::run("kv_store multi-get (batches of 100)", operations, [&]
+    {
+        for (size_t i = 0; i < keys.size(); i += 100)
+        {
+            store.get(std::vector<int64_t>(keys.begin() + i, keys.begin() + std::min(i + 100, keys.size())));
+        }
+    });
+
+    benchmark::run("raw prepare per put", operations, [&]
+    {
+        db.begin();
+        for (auto key : keys)
+        {
+            db.execute("INSERT OR REPLACE INTO kv(key, value) VALUES (?, ?)", key, "updated");
+        }
+        db.commit();
+    });
+
+    benchmark::run("kv_store put", operations, [&]
+    {
+        db.begin();
+        for (auto key : keys)
+        {
+            store.put(key, "updated");
+        }
+        db.commit();
+    });
+
+    return 0;
+}
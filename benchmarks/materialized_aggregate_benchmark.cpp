@@ -0,0 +1,71 @@
+#include <sqlite3_wrapper/sqlite3_materialized_aggregate.h>
+
+#include "benchmark.h"
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+namespace
+{
+    void insert_sales(sqlite::db &db, size_t rows, size_t offset)
+    {
+        auto statement = db.prepare("INSERT INTO sales(region, product, amount) VALUES (?, ?, ?)");
+        db.begin();
+        for (size_t i = offset; i < offset + rows; ++i)
+        {
+            statement.execute("region" + std::to_string(i % 20), "product" + std::to_string(i % 50), static_cast<double>(i % 100));
+        }
+        db.commit();
+    }
+}
+
+int main()
+{
+    const size_t rows = 500000;
+    const size_t inserts = 100000;
+    const size_t reads = 1000;
+
+    sqlite::db db(":memory:");
+    db.execute("CREATE TABLE sales(id INTEGER PRIMARY KEY, region TEXT NOT NULL, product TEXT NOT NULL, amount REAL NOT NULL)");
+    insert_sales(db, rows, 0);
+
+    benchmark::run("insert without aggregate", inserts, [&] { insert_sales(db, inserts, rows); });
+
+    benchmark::run("GROUP BY over source", reads / 100, [&]
+    {
+        auto statement = db.prepare("SELECT count(*), sum(amount) FROM sales WHERE region = ? GROUP BY product");
+        for (size_t i = 0; i < reads / 100; ++i)
+        {
+            int64_t count;
+            double sum;
+            statement.execute("region" + std::to_string(i % 20));
+            while (statement.fetch(count, sum))
+            {
+            }
+        }
+    });
+
+    std::unique_ptr<sqlite::materialized_aggregate> aggregate;
+    benchmark::run("create and backfill aggregate", 1, [&]
+    {
+        aggregate.reset(new sqlite::materialized_aggregate(db, "sales_by_region_product", "sales", {"region", "product"}, {"amount"}));
+    });
+
+    benchmark::run("insert with aggregate triggers", inserts, [&] { insert_sales(db, inserts, rows + inserts); });
+
+    benchmark::run("read materialized aggregate", reads, [&]
+    {
+        auto statement = db.prepare("SELECT row_count, sum_amount FROM sales_by_region_product WHERE region = ?");
+        for (size_t i = 0; i < reads; ++i)
+        {
+            int64_t count;
+            double sum;
+            statement.execute("region" + std::to_string(i % 20));
+            while (statement.fetch(count, sum))
+            {
+            }
+        }
+    });
+
+    return 0;
+}
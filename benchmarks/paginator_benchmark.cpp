@@ -0,0 +1,53 @@
+#include <sqlite3_wrapper/sqlite3_paginator.h>
+
+#include "benchmark.h"
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+int main()
+{
+    const size_t records = 200000;
+    const size_t page_size = 50;
+    const size_t pages = records / page_size;
+
+    sqlite::db db(":memory:");
+    db.execute("CREATE TABLE accounts(id INTEGER PRIMARY KEY, login TEXT NOT NULL)");
+
+    auto insert_statement = db.prepare("INSERT INTO accounts(id, login) VALUES (?, ?)");
+    db.begin();
+    for (size_t i = 0; i < records; ++i)
+    {
+        insert_statement.execute(static_cast<int64_t>(i), "login" + std::to_string(i));
+    }
+    db.commit();
+
+    benchmark::run("LIMIT/OFFSET, all pages", pages, [&]
+    {
+        auto statement = db.prepare("SELECT id, login FROM accounts ORDER BY id LIMIT ? OFFSET ?");
+        int64_t id;
+        std::string login;
+        for (size_t page = 0; page < pages; ++page)
+        {
+            statement.execute(static_cast<int64_t>(page_size), static_cast<int64_t>(page * page_size));
+            while (statement.fetch(id, login))
+            {
+            }
+        }
+    });
+
+    benchmark::run("paginator, all pages", pages, [&]
+    {
+        sqlite::paginator<int64_t, std::string> paginator(db, "accounts", "id", "login", "", page_size);
+        sqlite::paginator<int64_t, std::string>::page page;
+        std::string cursor;
+        do
+        {
+            paginator.fetch(cursor, page);
+            cursor = page.next_cursor;
+        }
+        while (!cursor.empty());
+    });
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <sqlite3_wrapper/sqlite3_wrapper.h>
+
+#include "benchmark.h"
+
+#include <random>
+#include <vector>
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+int main()
+{
+    const size_t records = 100000;
+    const size_t operations = 1000000;
+
+    sqlite::db db(":memory:");
+    db.execute("CREATE TABLE documents(id INTEGER PRIMARY KEY, body BLOB)");
+
+    auto insert_statement = db.prepare("INSERT INTO documents(id, body) VALUES (?, ?)");
+    db.begin();
+    for (size_t i = 1; i <= records; ++i)
+    {
+        insert_statement.execute(static_cast<int64_t>(i), std::string(100, 'a' + i % 26));
+    }
+    db.commit();
+
+    std::mt19937_64 random(42);
+    std::vector<int64_t> rowids(operations);
+    for (auto &rowid : rowids)
+    {
+        rowid = static_cast<int64_t>(1 + random() % records);
+    }
+
+    benchmark::run("SELECT by rowid", operations, [&]
+    {
+        auto statement = db.prepare("SELECT body FROM documents WHERE id = ?");
+        std::string value;
+        for (auto rowid : rowids)
+        {
+            statement.execute(rowid);
+            statement.fetch(value);
+            statement.reset();
+        }
+    });
+
+    benchmark::run("point_reader into std::string", operations, [&]
+    {
+        auto reader = db.open_point_reader("documents", "body");
+        std::string value;
+        for (auto rowid : rowids)
+        {
+            reader.read(rowid, value);
+        }
+    });
+
+    // the blob handle is kept and moved with sqlite3_blob_reopen only inside a transaction
+    benchmark::run("point_reader into std::string in a transaction", operations, [&]
+    {
+        auto reader = db.open_point_reader("documents", "body");
+        std::string value;
+        db.begin();
+        for (auto rowid : rowids)
+        {
+            reader.read(rowid, value);
+        }
+        db.commit();
+    });
+
+    benchmark::run("point_reader into buffer in a transaction", operations, [&]
+    {
+        auto reader = db.open_point_reader("documents", "body");
+        char buffer[256];
+        db.begin();
+        for (auto rowid : rowids)
+        {
+            reader.read(rowid, buffer, sizeof(buffer));
+        }
+        db.commit();
+    });
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <sqlite3_wrapper/sqlite3_read_executor.h>
+
+#include <cstdio>
+#include <random>
+
+namespace sqlite = sqlite3_wrapper;
+
+// Mixed-latency reads (point lookups with some range scans) submitted at a steady rate round robin to per-worker
+// queues, with jobs pinned to their worker and with work stealing. The scans all land on the first worker,
+// like a skewed key affinity, so its backlog delays the lookups queued behind them unless they are stolen.
+namespace
+{
+    const char *filename = "read_executor_benchmark.db";
+    const size_t rows = 200000;
+    const size_t workers = 4;
+    const size_t jobs = 10000;
+    const auto interval = std::chrono::microseconds(200);
+    // one job in scan_every is a range scan, a multiple of workers
+    const size_t scan_every = workers * 6;
+
+    void run(const char *name, bool steal)
+    {
+        sqlite::read_executor executor([] { return sqlite::db(filename, sqlite::threading_mode::MULTI_THREAD, SQLITE_OPEN_READONLY); }, workers, steal);
+        std::mt19937_64 random(42);
+
+        std::vector<std::future<double>> results;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < jobs; ++i)
+        {
+            std::this_thread::sleep_until(start + i * interval);
+            auto submitted = std::chrono::steady_clock::now();
+            auto id = static_cast<int64_t>(random() % rows + 1);
+            if (i % scan_every == 0)
+            {
+                results.push_back(executor.submit([=](sqlite::cached_connection &connection)
+                {
+                    int64_t total = 0;
+                    connection.execute("SELECT sum(length(payload)) FROM items WHERE id BETWEEN ? AND ?", id, id + 20000).fetch(total);
+                    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitted).count();
+                }));
+            }
+            else
+            {
+                results.push_back(executor.submit([=](sqlite::cached_connection &connection)
+                {
+                    std::string payload;
+                    connection.execute("SELECT payload FROM items WHERE id = ?", id).fetch(payload);
+                    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitted).count();
+                }));
+            }
+        }
+
+        std::vector<double> latencies;
+        for (auto &result : results)
+        {
+            latencies.push_back(result.get());
+        }
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::sort(latencies.begin(), latencies.end());
+
+        std::printf("%-12s %10.0f jobs/s  latency p50 %8.3f ms  p99 %8.3f ms  max %8.3f ms  stolen %llu\n", name, jobs / elapsed,
+            latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back(),
+            static_cast<unsigned long long>(executor.stolen()));
+    }
+}
+
+int main()
+{
+    std::remove(filename);
+    {
+        sqlite::db db(filename);
+        db.execute("PRAGMA journal_mode = WAL").fetch();
+        db.execute("CREATE TABLE items(id INTEGER PRIMARY KEY, payload TEXT NOT NULL)");
+        auto statement = db.prepare("INSERT INTO items(payload) VALUES (?)");
+        db.begin();
+        for (size_t i = 0; i < rows; ++i)
+        {
+            statement.execute(std::string(50 + i % 100, 'a' + i % 26));
+        }
+        db.commit();
+    }
+
+    run("pinned", false);
+    run("stealing", true);
+
+    for (auto suffix : {"", "-wal", "-shm"})
+    {
+        std::remove((std::string(filename) + suffix).c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <sqlite3_wrapper/sqlite3_shared_memory.h>
+
+#include "benchmark.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+namespace
+{
+    const size_t records = 100000;
+    const size_t operations = 200000;
+    const unsigned int threads = 4;
+
+    void load(sqlite::db &db)
+    {
+        db.execute("CREATE TABLE cache(id INTEGER PRIMARY KEY, value TEXT)");
+        auto statement = db.prepare("INSERT INTO cache(id, value) VALUES (?, ?)");
+        for (size_t i = 0; i < records; ++i)
+        {
+            statement.execute(static_cast<int64_t>(i), "value" + std::to_string(i));
+        }
+    }
+
+    void query(sqlite::db &db)
+    {
+        auto statement = db.prepare("SELECT value FROM cache WHERE id = ?");
+        std::string value;
+        for (size_t i = 0; i < operations; ++i)
+        {
+            statement.execute(static_cast<int64_t>((i * 7919) % records));
+            statement.fetch(value);
+            statement.reset();
+        }
+    }
+
+    template<class F>
+    void run_threads(F &&f)
+    {
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < threads; ++i)
+        {
+            workers.emplace_back(f);
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+}
+
+int main()
+{
+    {
+        std::vector<std::unique_ptr<sqlite::db>> copies;
+        for (unsigned int i = 0; i < threads; ++i)
+        {
+            copies.emplace_back(new sqlite::db(":memory:", sqlite::threading_mode::MULTI_THREAD));
+            copies.back()->begin();
+            load(*copies.back());
+            copies.back()->commit();
+        }
+        std::printf("per-thread copies: %lld KiB\n", static_cast<long long>(sqlite3_memory_used() / 1024));
+
+        std::atomic<size_t> next(0);
+        benchmark::run("per-thread copies, point select", operations * threads, [&]
+        {
+            run_threads([&]
+            {
+                auto i = next++;
+                copies[i]->attach_to_current_thread();
+                query(*copies[i]);
+            });
+        });
+    }
+
+    {
+        sqlite::shared_memory_cache cache("shared_memory_benchmark");
+        cache.refresh(load);
+        std::printf("shared cache: %lld KiB\n", static_cast<long long>(sqlite3_memory_used() / 1024));
+
+        benchmark::run("shared cache, point select", operations * threads, [&]
+        {
+            run_threads([&]
+            {
+                auto reader = cache.make_reader();
+                query(reader.connection());
+            });
+        });
+
+        benchmark::run("shared cache, select during refresh", operations * threads, [&]
+        {
+            std::thread writer([&]
+            {
+                cache.refresh(load);
+            });
+            run_threads([&]
+            {
+                auto reader = cache.make_reader();
+                query(reader.connection());
+            });
+            writer.join();
+        });
+    }
+
+    return 0;
+}
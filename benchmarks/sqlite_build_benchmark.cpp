@@ -0,0 +1,88 @@
+#include <sqlite3_wrapper/sqlite3_wrapper.h>
+
+#include "benchmark.h"
+
+#include <random>
+#include <vector>
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+// Compare the output of sqlite_build_benchmark and sqlite_build_benchmark_bundled
+int main()
+{
+    const std::string filename = "sqlite_build_benchmark.db";
+    const size_t records = 200000;
+    const size_t operations = 500000;
+
+    std::printf("SQLite %s, threadsafe %d\n", sqlite3_libversion(), sqlite3_threadsafe());
+
+    std::remove(filename.c_str());
+    std::remove((filename + "-wal").c_str());
+    std::remove((filename + "-shm").c_str());
+
+    {
+        sqlite::db db(filename);
+        db.execute("PRAGMA journal_mode = WAL").fetch();
+        db.execute("CREATE TABLE accounts(id INTEGER PRIMARY KEY, login TEXT NOT NULL, balance INTEGER NOT NULL)");
+        db.execute("CREATE INDEX accounts_login ON accounts(login)");
+
+        benchmark::run("insert", records, [&]
+        {
+            auto statement = db.prepare("INSERT INTO accounts(id, login, balance) VALUES (?, ?, ?)");
+            db.begin();
+            for (size_t i = 0; i < records; ++i)
+            {
+                statement.execute(static_cast<int64_t>(i), "login" + std::to_string(i), static_cast<int64_t>(i % 1000));
+            }
+            db.commit();
+        });
+
+        std::mt19937_64 random(42);
+        std::vector<int64_t> ids(operations);
+        for (auto &id : ids)
+        {
+            id = static_cast<int64_t>(random() % records);
+        }
+
+        benchmark::run("point select", operations, [&]
+        {
+            auto statement = db.prepare("SELECT login, balance FROM accounts WHERE id = ?");
+            std::string login;
+            int64_t balance;
+            for (auto id : ids)
+            {
+                statement.execute(id);
+                statement.fetch(login, balance);
+                statement.reset();
+            }
+        });
+
+        benchmark::run("update in autocommit", operations / 10, [&]
+        {
+            auto statement = db.prepare("UPDATE accounts SET balance = balance + 1 WHERE id = ?");
+            for (size_t i = 0; i < operations / 10; ++i)
+            {
+                statement.execute(ids[i]);
+            }
+        });
+
+        benchmark::run("LIKE prefix scan", 100, [&]
+        {
+            auto statement = db.prepare("SELECT COUNT(*) FROM accounts WHERE login LIKE ?");
+            int64_t count;
+            for (size_t i = 0; i < 100; ++i)
+            {
+                statement.execute("login" + std::to_string(i) + "%");
+                statement.fetch(count);
+                statement.reset();
+            }
+        });
+    }
+
+    std::remove(filename.c_str());
+    std::remove((filename + "-wal").c_str());
+    std::remove((filename + "-shm").c_str());
+
+    return 0;
+}
@@ -0,0 +1,529 @@
+#include <sqlite3_wrapper/sqlite3_wrapper.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <type_traits>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace sqlite = sqlite3_wrapper;
+
+// Concurrency stress of one WAL database from several processes, each running a checkpointer, a long reader
+// holding its snapshot and writers doing balance transfers with point reads.
+// Usage: stress_benchmark [--processes N] [--threads N] [--seconds N] [--busy-timeout ms] [--hold ms] [--db path]
+// Prints busy rate and p50/p99/p999 latency per operation, then verifies invariants; exits with 1 on errors
+// or violated invariants. Build with -DSQLITE3_WRAPPER_SANITIZER=thread to run it under ThreadSanitizer.
+namespace
+{
+    enum operation
+    {
+        TRANSFER,
+        POINT_READ,
+        LONG_READ,
+        CHECKPOINT,
+        OPERATIONS_COUNT
+    };
+
+    const char *operation_names[] = {"transfer", "point_read", "long_read", "checkpoint"};
+
+    const int64_t accounts = 1000;
+    const int64_t initial_balance = 1000;
+
+    struct options
+    {
+        unsigned int processes = 2;
+        unsigned int threads = 4;
+        unsigned int seconds = 10;
+        int busy_timeout = 50;
+        unsigned int hold = 50;
+        std::string filename = "stress_benchmark.db";
+    };
+
+    struct results
+    {
+        std::vector<uint64_t> latencies[OPERATIONS_COUNT];
+        uint64_t busy[OPERATIONS_COUNT] = {};
+        uint64_t committed = 0;
+        uint64_t errors = 0;
+        uint64_t violations = 0;
+
+        void merge(const results &other)
+        {
+            for (int op = 0; op < OPERATIONS_COUNT; ++op)
+            {
+                latencies[op].insert(latencies[op].end(), other.latencies[op].begin(), other.latencies[op].end());
+                busy[op] += other.busy[op];
+            }
+            committed += other.committed;
+            errors += other.errors;
+            violations += other.violations;
+        }
+    };
+
+    sqlite::db open(const options &options)
+    {
+        sqlite::db db(options.filename, sqlite::threading_mode::MULTI_THREAD);
+        db.execute("PRAGMA busy_timeout = " + std::to_string(options.busy_timeout));
+        db.execute("PRAGMA synchronous = NORMAL");
+        // checkpoints are driven by the checkpointer thread
+        db.execute("PRAGMA wal_autocheckpoint = 0").fetch();
+
+        return db;
+    }
+
+    void remove_database(const options &options)
+    {
+        std::remove(options.filename.c_str());
+        std::remove((options.filename + "-wal").c_str());
+        std::remove((options.filename + "-shm").c_str());
+    }
+
+    void create(const options &options)
+    {
+        remove_database(options);
+
+        auto db = open(options);
+        db.execute("PRAGMA journal_mode = WAL").fetch();
+        db.execute("CREATE TABLE accounts(id INTEGER PRIMARY KEY, balance INTEGER NOT NULL)");
+        db.execute("CREATE TABLE history(id INTEGER PRIMARY KEY, source INTEGER NOT NULL, target INTEGER NOT NULL, amount INTEGER NOT NULL)");
+
+        auto statement = db.prepare("INSERT INTO accounts(id, balance) VALUES (?, ?)");
+        db.begin();
+        for (int64_t id = 0; id < accounts; ++id)
+        {
+            statement.execute(id, initial_balance);
+        }
+        db.commit();
+    }
+
+    uint64_t since(std::chrono::steady_clock::time_point begin)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+    }
+
+    // Runs op, counting busy attempts and retrying them until the deadline. f may return false for a busy
+    // result without an error, which is counted as busy and not retried.
+    template<class F>
+    void measure(results &results, operation op, sqlite::db &db, std::chrono::steady_clock::time_point deadline, F &&f)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        for (;;)
+        {
+            try
+            {
+                if constexpr (std::is_same<decltype(f()), bool>::value)
+                {
+                    if (!f())
+                    {
+                        ++results.busy[op];
+                        return;
+                    }
+                }
+                else
+                {
+                    f();
+                }
+                results.latencies[op].push_back(since(begin));
+                return;
+            }
+            catch (const sqlite::exception &e)
+            {
+                if (!db.autocommit())
+                {
+                    db.rollback();
+                }
+
+                if (!e.busy())
+                {
+                    std::fprintf(stderr, "%s: %s\n", operation_names[op], e.what());
+                    ++results.errors;
+                    return;
+                }
+                ++results.busy[op];
+
+                if (std::chrono::steady_clock::now() >= deadline)
+                {
+                    return;
+                }
+            }
+        }
+    }
+
+    void writer(const options &options, unsigned int seed, std::chrono::steady_clock::time_point deadline, results &results)
+    {
+        auto db = open(options);
+        auto debit_statement = db.prepare("UPDATE accounts SET balance = balance - ? WHERE id = ?");
+        auto credit_statement = db.prepare("UPDATE accounts SET balance = balance + ? WHERE id = ?");
+        auto history_statement = db.prepare("INSERT INTO history(source, target, amount) VALUES (?, ?, ?)");
+        auto read_statement = db.prepare("SELECT balance FROM accounts WHERE id = ?");
+
+        std::mt19937_64 random(seed);
+        std::uniform_int_distribution<int64_t> account(0, accounts - 1);
+        std::uniform_int_distribution<int64_t> amount(1, 10);
+
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            if (random() % 4 == 0)
+            {
+                auto id = account(random);
+                measure(results, POINT_READ, db, deadline, [&]
+                {
+                    int64_t balance;
+                    read_statement.execute(id);
+                    read_statement.fetch(balance);
+                    read_statement.reset();
+                });
+                continue;
+            }
+
+            auto source = account(random);
+            auto target = account(random);
+            auto value = amount(random);
+            measure(results, TRANSFER, db, deadline, [&]
+            {
+                db.begin(sqlite::transaction_type::IMMEDIATE);
+                debit_statement.execute(value, source);
+                credit_statement.execute(value, target);
+                history_statement.execute(source, target, value);
+                db.commit();
+                ++results.committed;
+            });
+        }
+    }
+
+    // Holds a read transaction open across two scans, which must see the same consistent total
+    void long_reader(const options &options, std::chrono::steady_clock::time_point deadline, results &results)
+    {
+        auto db = open(options);
+        auto sum_statement = db.prepare("SELECT sum(balance) FROM accounts");
+
+        auto sum = [&]
+        {
+            int64_t total = 0;
+            sum_statement.execute();
+            sum_statement.fetch(total);
+            sum_statement.reset();
+
+            return total;
+        };
+
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            measure(results, LONG_READ, db, deadline, [&]
+            {
+                db.begin();
+                auto first = sum();
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.hold));
+                auto second = sum();
+                db.commit();
+
+                if (first != accounts * initial_balance || second != first)
+                {
+                    ++results.violations;
+                }
+            });
+        }
+    }
+
+    // Alternates passive checkpoints with truncating ones, which wait for readers of old snapshots
+    void checkpointer(const options &options, std::chrono::steady_clock::time_point deadline, results &results)
+    {
+        auto db = open(options);
+        auto passive_statement = db.prepare("PRAGMA wal_checkpoint(PASSIVE)");
+        auto truncate_statement = db.prepare("PRAGMA wal_checkpoint(TRUNCATE)");
+
+        for (unsigned int i = 0; std::chrono::steady_clock::now() < deadline; ++i)
+        {
+            auto &statement = i % 10 == 9 ? truncate_statement : passive_statement;
+            measure(results, CHECKPOINT, db, deadline, [&]
+            {
+                int64_t busy = 0;
+                int64_t log = 0;
+                int64_t checkpointed = 0;
+                statement.execute();
+                statement.fetch(busy, log, checkpointed);
+                statement.reset();
+
+                return busy == 0;
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+
+    results run_process(const options &options, unsigned int process)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(options.seconds);
+
+        std::vector<results> thread_results(options.threads);
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < options.threads; ++t)
+        {
+            threads.emplace_back([&, t]
+            {
+                try
+                {
+                    if (t == 0 && options.threads > 2)
+                    {
+                        checkpointer(options, deadline, thread_results[t]);
+                    }
+                    else if (t == 1 && options.threads > 2)
+                    {
+                        long_reader(options, deadline, thread_results[t]);
+                    }
+                    else
+                    {
+                        writer(options, process * options.threads + t + 1, deadline, thread_results[t]);
+                    }
+                }
+                catch (const std::exception &e)
+                {
+                    std::fprintf(stderr, "thread %u: %s\n", t, e.what());
+                    ++thread_results[t].errors;
+                }
+            });
+        }
+
+        results results;
+        for (unsigned int t = 0; t < options.threads; ++t)
+        {
+            threads[t].join();
+            results.merge(thread_results[t]);
+        }
+
+        return results;
+    }
+
+    bool write_all(int fd, const void *data, size_t size)
+    {
+        auto bytes = static_cast<const char *>(data);
+        while (size)
+        {
+            auto written = ::write(fd, bytes, size);
+            if (written <= 0)
+            {
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+
+        return true;
+    }
+
+    bool read_all(int fd, void *data, size_t size)
+    {
+        auto bytes = static_cast<char *>(data);
+        while (size)
+        {
+            auto read = ::read(fd, bytes, size);
+            if (read <= 0)
+            {
+                return false;
+            }
+            bytes += read;
+            size -= static_cast<size_t>(read);
+        }
+
+        return true;
+    }
+
+    bool write_results(int fd, const results &results)
+    {
+        uint64_t header[] = {results.committed, results.errors, results.violations};
+        if (!write_all(fd, header, sizeof(header)) || !write_all(fd, results.busy, sizeof(results.busy)))
+        {
+            return false;
+        }
+
+        for (const auto &latencies : results.latencies)
+        {
+            uint64_t size = latencies.size();
+            if (!write_all(fd, &size, sizeof(size)) || !write_all(fd, latencies.data(), size * sizeof(uint64_t)))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool read_results(int fd, results &results)
+    {
+        uint64_t header[3];
+        if (!read_all(fd, header, sizeof(header)) || !read_all(fd, results.busy, sizeof(results.busy)))
+        {
+            return false;
+        }
+        results.committed = header[0];
+        results.errors = header[1];
+        results.violations = header[2];
+
+        for (auto &latencies : results.latencies)
+        {
+            uint64_t size;
+            if (!read_all(fd, &size, sizeof(size)))
+            {
+                return false;
+            }
+            latencies.resize(size);
+            if (!read_all(fd, latencies.data(), size * sizeof(uint64_t)))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // The first process is the current one, the others are forked and report their results through pipes
+    results run(const options &options)
+    {
+        std::vector<std::pair<pid_t, int>> children;
+        for (unsigned int process = 1; process < options.processes; ++process)
+        {
+            int fds[2];
+            if (pipe(fds) != 0)
+            {
+                throw std::runtime_error("pipe failed");
+            }
+
+            auto pid = fork();
+            if (pid < 0)
+            {
+                throw std::runtime_error("fork failed");
+            }
+            if (pid == 0)
+            {
+                close(fds[0]);
+                auto ok = write_results(fds[1], run_process(options, process));
+                close(fds[1]);
+                _exit(ok ? 0 : 1);
+            }
+
+            close(fds[1]);
+            children.emplace_back(pid, fds[0]);
+        }
+
+        auto results = run_process(options, 0);
+
+        for (const auto &child : children)
+        {
+            struct results child_results;
+            if (!read_results(child.second, child_results))
+            {
+                ++results.errors;
+            }
+            close(child.second);
+
+            int status;
+            if (waitpid(child.first, &status, 0) != child.first || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            {
+                ++results.errors;
+            }
+            results.merge(child_results);
+        }
+
+        return results;
+    }
+
+    uint64_t percentile(const std::vector<uint64_t> &sorted, double p)
+    {
+        return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+    }
+
+    // Checks that every committed transfer is in history, money is preserved and the file is intact
+    uint64_t verify(const options &options, const results &results)
+    {
+        uint64_t violations = 0;
+        auto db = open(options);
+
+        int64_t history_count = 0;
+        db.execute("SELECT count(*) FROM history").fetch(history_count);
+        if (static_cast<uint64_t>(history_count) != results.committed)
+        {
+            std::printf("history has %lld transfers, %llu committed\n", static_cast<long long>(history_count), static_cast<unsigned long long>(results.committed));
+            ++violations;
+        }
+
+        int64_t total = 0;
+        db.execute("SELECT sum(balance) FROM accounts").fetch(total);
+        if (total != accounts * initial_balance)
+        {
+            std::printf("total balance is %lld, expected %lld\n", static_cast<long long>(total), static_cast<long long>(accounts * initial_balance));
+            ++violations;
+        }
+
+        std::string integrity;
+        db.execute("PRAGMA integrity_check").fetch(integrity);
+        if (integrity != "ok")
+        {
+            std::printf("integrity_check: %s\n", integrity.c_str());
+            ++violations;
+        }
+
+        return violations;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--processes")
+        {
+            options.processes = static_cast<unsigned int>(std::max(1, std::atoi(argv[i + 1])));
+        }
+        else if (arg == "--threads")
+        {
+            options.threads = static_cast<unsigned int>(std::max(1, std::atoi(argv[i + 1])));
+        }
+        else if (arg == "--seconds")
+        {
+            options.seconds = static_cast<unsigned int>(std::max(1, std::atoi(argv[i + 1])));
+        }
+        else if (arg == "--busy-timeout")
+        {
+            options.busy_timeout = std::max(0, std::atoi(argv[i + 1]));
+        }
+        else if (arg == "--hold")
+        {
+            options.hold = static_cast<unsigned int>(std::max(0, std::atoi(argv[i + 1])));
+        }
+        else if (arg == "--db")
+        {
+            options.filename = argv[i + 1];
+        }
+    }
+
+    create(options);
+    auto results = run(options);
+
+    std::printf("%u processes x %u threads, %u s, busy_timeout %d ms, sqlite %s\n", options.processes, options.threads, options.seconds,
+        options.busy_timeout, sqlite3_libversion());
+    std::printf("%-12s %10s %10s %10s %12s %12s %12s\n", "operation", "count", "busy", "busy rate", "p50 us", "p99 us", "p999 us");
+    for (int op = 0; op < OPERATIONS_COUNT; ++op)
+    {
+        auto &latencies = results.latencies[op];
+        std::sort(latencies.begin(), latencies.end());
+
+        auto attempts = latencies.size() + results.busy[op];
+        std::printf("%-12s %10zu %10llu %9.2f%% %12.1f %12.1f %12.1f\n", operation_names[op], latencies.size(), static_cast<unsigned long long>(results.busy[op]),
+            attempts ? 100.0 * results.busy[op] / attempts : 0.0, percentile(latencies, 0.5) / 1e3, percentile(latencies, 0.99) / 1e3,
+            percentile(latencies, 0.999) / 1e3);
+    }
+
+    auto violations = results.violations + verify(options, results);
+    std::printf("committed %llu, errors %llu, violations %llu\n", static_cast<unsigned long long>(results.committed),
+        static_cast<unsigned long long>(results.errors), static_cast<unsigned long long>(violations));
+
+    remove_database(options);
+
+    return results.errors || violations ? 1 : 0;
+}
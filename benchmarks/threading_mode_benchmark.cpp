@@ -0,0 +1,47 @@
+#include <sqlite3_wrapper/sqlite3_wrapper.h>
+
+#include "benchmark.h"
+
+#include <cstdio>
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+int main()
+{
+    const size_t records = 10000;
+    const size_t operations = 1000000;
+
+#ifndef NDEBUG
+    std::fprintf(stderr, "warning: built without NDEBUG, multi-thread connections pay for debug thread-affinity checks\n");
+#endif
+
+    for (auto mode : {sqlite::threading_mode::SERIALIZED, sqlite::threading_mode::MULTI_THREAD})
+    {
+        sqlite::db db(":memory:", mode);
+        db.execute("CREATE TABLE t(id INTEGER PRIMARY KEY, value INTEGER)");
+
+        auto insert_statement = db.prepare("INSERT INTO t(id, value) VALUES (?, ?)");
+        db.begin();
+        for (size_t i = 0; i < records; ++i)
+        {
+            insert_statement.execute(static_cast<int64_t>(i), static_cast<int64_t>(i));
+        }
+        db.commit();
+
+        auto name = mode == sqlite::threading_mode::SERIALIZED ? "point select, serialized" : "point select, multi-thread";
+        benchmark::run(name, operations, [&]
+        {
+            auto statement = db.prepare("SELECT value FROM t WHERE id = ?");
+            int64_t value;
+            for (size_t i = 0; i < operations; ++i)
+            {
+                statement.execute(static_cast<int64_t>(i % records));
+                statement.fetch(value);
+                statement.reset();
+            }
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <sqlite3_wrapper/sqlite3_wal_archive.h>
+
+#include "benchmark.h"
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+int main()
+{
+    const std::string filename = "wal_archive_benchmark.db";
+    const std::string restored_filename = "wal_archive_benchmark_restored.db";
+    const std::string shipping_directory = "wal_archive_benchmark_shipping";
+    const std::string archive_directory = "wal_archive_benchmark_archive";
+    const size_t segments = 2000;
+    const size_t rows_per_segment = 50;
+
+    std::remove(filename.c_str());
+    std::filesystem::remove_all(shipping_directory);
+    std::filesystem::remove_all(archive_directory);
+
+    sqlite::wal_archive archive(archive_directory);
+    {
+        sqlite::db db(filename);
+        db.execute("PRAGMA journal_mode = WAL").fetch();
+        db.execute("PRAGMA synchronous = NORMAL");
+        db.execute("CREATE TABLE events(id INTEGER PRIMARY KEY, payload TEXT NOT NULL)");
+
+        sqlite::wal_shipper shipper(db, shipping_directory);
+        archive.attach(shipper);
+
+        benchmark::run("archive segment per commit", segments, [&]
+        {
+            auto statement = db.prepare("INSERT INTO events(payload) VALUES (?)");
+            for (size_t i = 0; i < segments; ++i)
+            {
+                db.begin();
+                for (size_t j = 0; j < rows_per_segment; ++j)
+                {
+                    statement.execute("event payload " + std::to_string(i * rows_per_segment + j) + std::string(100, 'x'));
+                }
+                db.commit();
+            }
+        });
+    }
+
+    for (unsigned int threads : {1u, 4u})
+    {
+        std::remove(restored_filename.c_str());
+        benchmark::run("restore, " + std::to_string(threads) + " decompression threads", segments, [&]
+        {
+            archive.restore(restored_filename, archive.sequence(), threads);
+        });
+    }
+
+    std::remove(filename.c_str());
+    std::remove((filename + "-wal").c_str());
+    std::remove((filename + "-shm").c_str());
+    std::remove(restored_filename.c_str());
+    std::filesystem::remove_all(shipping_directory);
+    std::filesystem::remove_all(archive_directory);
+
+    return 0;
+}
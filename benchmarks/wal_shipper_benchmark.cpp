@@ -0,0 +1,104 @@
+#include <sqlite3_wrapper/sqlite3_wal_shipper.h>
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+namespace
+{
+    sqlite::db open(const std::string &filename)
+    {
+        sqlite::db db(filename, sqlite::threading_mode::MULTI_THREAD);
+        db.execute("PRAGMA journal_mode = WAL").fetch();
+        db.execute("PRAGMA synchronous = NORMAL");
+
+        return db;
+    }
+
+    void remove_database(const std::string &filename)
+    {
+        std::remove(filename.c_str());
+        std::remove((filename + "-wal").c_str());
+        std::remove((filename + "-shm").c_str());
+    }
+
+    // Commits on the primary while a standby applier polls the shipping directory every millisecond
+    void run(const std::string &name, size_t transactions, std::chrono::milliseconds batch_interval)
+    {
+        const std::string primary_filename = "wal_shipper_benchmark.db";
+        const std::string standby_filename = "wal_shipper_benchmark_standby.db";
+        const std::string directory = "wal_shipper_benchmark";
+        remove_database(primary_filename);
+        remove_database(standby_filename);
+        std::filesystem::remove_all(directory);
+
+        auto primary = open(primary_filename);
+        primary.execute("CREATE TABLE events(id INTEGER PRIMARY KEY, payload TEXT NOT NULL)");
+
+        std::vector<int64_t> delays;
+        {
+            sqlite::wal_shipper shipper(primary, directory, batch_interval);
+
+            std::atomic<bool> done(false);
+            std::thread applier_thread([&]
+            {
+                auto standby = open(standby_filename);
+                sqlite::replica_applier applier(standby, directory);
+                for (;;)
+                {
+                    auto stop = done.load();
+                    if (applier.apply())
+                    {
+                        delays.push_back(applier.lag().delay.count());
+                    }
+                    if (stop)
+                    {
+                        break;
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            });
+
+            benchmark::run(name, transactions, [&]
+            {
+                auto statement = primary.prepare("INSERT INTO events(payload) VALUES (?)");
+                std::string payload(100, 'x');
+                for (size_t i = 0; i < transactions; ++i)
+                {
+                    statement.execute(payload);
+                }
+                shipper.ship();
+            });
+
+            done = true;
+            applier_thread.join();
+        }
+
+        std::sort(delays.begin(), delays.end());
+        auto percentile = [&](double p)
+        {
+            return delays.empty() ? 0.0 : delays[std::min(delays.size() - 1, static_cast<size_t>(p * delays.size()))] / 1e6;
+        };
+        std::printf("%-40s lag p50 %.2f ms, p99 %.2f ms over %zu applies\n", "", percentile(0.5), percentile(0.99), delays.size());
+
+        remove_database(primary_filename);
+        remove_database(standby_filename);
+        std::filesystem::remove_all(directory);
+    }
+}
+
+int main()
+{
+    const size_t transactions = 20000;
+
+    run("ship every commit", transactions, std::chrono::milliseconds(0));
+    run("ship batches every 5ms", transactions, std::chrono::milliseconds(5));
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <sqlite3_wrapper/sqlite3_warmup.h>
+
+#include "benchmark.h"
+
+#include <random>
+
+namespace sqlite = sqlite3_wrapper;
+namespace benchmark = sqlite3_wrapper_benchmark;
+
+namespace
+{
+    // Drops clean pages of the file from the OS page cache, as after a restart
+    void evict(const std::string &filename)
+    {
+        auto fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd >= 0)
+        {
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    }
+
+    void lookups(const std::string &filename, size_t rows, size_t operations)
+    {
+        sqlite::db db(filename, SQLITE_OPEN_READONLY);
+        auto statement = db.prepare("SELECT payload FROM items WHERE id = ?");
+        std::mt19937_64 random(7);
+        std::string payload;
+        for (size_t i = 0; i < operations; ++i)
+        {
+            statement.execute(static_cast<int64_t>(random() % rows));
+            statement.fetch(payload);
+            statement.reset();
+        }
+    }
+}
+
+int main()
+{
+    const std::string filename = "warmup_benchmark.db";
+    const std::string profile = "warmup_benchmark.profile";
+    const size_t rows = 200000;
+    const size_t operations = 20000;
+
+    std::remove(filename.c_str());
+    {
+        sqlite::db db(filename);
+        db.execute("CREATE TABLE items(id INTEGER PRIMARY KEY, payload TEXT NOT NULL)");
+        auto statement = db.prepare("INSERT INTO items(id, payload) VALUES (?, ?)");
+        db.begin();
+        for (size_t i = 0; i < rows; ++i)
+        {
+            statement.execute(static_cast<int64_t>(i), std::string(200, 'a' + i % 26));
+        }
+        db.commit();
+    }
+
+    {
+        sqlite::page_access_recorder recorder;
+        sqlite::db db(filename, SQLITE_OPEN_READONLY, recorder.name().c_str());
+        auto statement = db.prepare("SELECT payload FROM items WHERE id = ?");
+        std::mt19937_64 random(7);
+        std::string payload;
+        for (size_t i = 0; i < operations; ++i)
+        {
+            statement.execute(static_cast<int64_t>(random() % rows));
+            statement.fetch(payload);
+            statement.reset();
+        }
+        sqlite::save_warmup_profile(profile, recorder.hot_pages(filename));
+    }
+
+    evict(filename);
+    benchmark::run("lookups, cold page cache", operations, [&] { lookups(filename, rows, operations); });
+
+    evict(filename);
+    {
+        sqlite::db db(filename, SQLITE_OPEN_READONLY);
+        benchmark::run("prefetch interior pages", 1, [&] { sqlite::page_prefetcher(db, sqlite::interior_pages(db)).wait(); });
+    }
+    benchmark::run("lookups, interior pages prefetched", operations, [&] { lookups(filename, rows, operations); });
+
+    evict(filename);
+    benchmark::run("prefetch recorded profile", 1, [&] { sqlite::page_prefetcher(filename, sqlite::load_warmup_profile(profile)).wait(); });
+    benchmark::run("lookups, recorded profile prefetched", operations, [&] { lookups(filename, rows, operations); });
+
+    std::remove(filename.c_str());
+    std::remove(profile.c_str());
+
+    return 0;
+}
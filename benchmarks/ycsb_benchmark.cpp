@@ -0,0 +1,440 @@
+#include <sqlite3_wrapper/sqlite3_wrapper.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+
+namespace sqlite = sqlite3_wrapper;
+
+// YCSB core workloads A-F over a usertable with 10 fields of 100 bytes.
+// Usage: ycsb_benchmark [--workload abcdef] [--records N] [--operations N] [--threads N] [--db path]
+// Prints throughput, p50/p99/p999 latency and errors per workload and operation as JSON.
+namespace
+{
+    enum operation
+    {
+        READ,
+        UPDATE,
+        INSERT,
+        SCAN,
+        READ_MODIFY_WRITE,
+        OPERATIONS_COUNT
+    };
+
+    const char *operation_names[] = {"read", "update", "insert", "scan", "read_modify_write"};
+
+    struct workload
+    {
+        char name;
+        // proportions of operations in the order of the operation enum
+        double proportions[OPERATIONS_COUNT];
+        bool latest;
+    };
+
+    const workload workloads[] = {
+        {'a', {0.5, 0.5, 0, 0, 0}, false},
+        {'b', {0.95, 0.05, 0, 0, 0}, false},
+        {'c', {1, 0, 0, 0, 0}, false},
+        {'d', {0.95, 0, 0.05, 0, 0}, true},
+        {'e', {0, 0, 0.05, 0.95, 0}, false},
+        {'f', {0.5, 0, 0, 0, 0.5}, false},
+    };
+
+    const int fields = 10;
+    const size_t field_size = 100;
+    const size_t max_scan_length = 100;
+
+    // Zipfian generator of YCSB (Gray et al., "Quickly generating billion-record synthetic databases")
+    class zipfian
+    {
+    public:
+        explicit zipfian(uint64_t items, double theta = 0.99)
+            : _items(items)
+        {
+            for (uint64_t i = 1; i <= items; ++i)
+            {
+                _zetan += 1 / std::pow(static_cast<double>(i), theta);
+            }
+            _zeta2 = 1 + 1 / std::pow(2.0, theta);
+            _alpha = 1 / (1 - theta);
+            _eta = (1 - std::pow(2.0 / items, 1 - theta)) / (1 - _zeta2 / _zetan);
+        }
+
+        template<class Random>
+        uint64_t operator()(Random &random) const
+        {
+            auto u = std::uniform_real_distribution<double>(0, 1)(random);
+            auto uz = u * _zetan;
+            if (uz < 1)
+            {
+                return 0;
+            }
+            if (uz < _zeta2)
+            {
+                return 1;
+            }
+
+            return std::min(_items - 1, static_cast<uint64_t>(_items * std::pow(_eta * u - _eta + 1, _alpha)));
+        }
+
+    private:
+        uint64_t _items;
+        double _zetan = 0;
+        double _zeta2;
+        double _alpha;
+        double _eta;
+    };
+
+    uint64_t fnv_hash(uint64_t value)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (int i = 0; i < 8; ++i)
+        {
+            hash = (hash ^ (value & 0xff)) * 0x100000001b3ull;
+            value >>= 8;
+        }
+
+        return hash;
+    }
+
+    std::string key(uint64_t number)
+    {
+        return "user" + std::to_string(fnv_hash(number));
+    }
+
+    // Numbers of inserted keys: next() claims one, acknowledge() publishes it once all lower numbers are done,
+    // so "latest" reads pick only keys below published() whose inserts finished (YCSB's acknowledged counter).
+    // Failed inserts are acknowledged too so that they do not hold back later keys.
+    class insert_counter
+    {
+    public:
+        explicit insert_counter(uint64_t records)
+            : _next(records)
+            , _published(records)
+        {
+        }
+
+        uint64_t next()
+        {
+            return _next++;
+        }
+
+        void acknowledge(uint64_t number)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _done.insert(number);
+
+            auto published = _published.load();
+            while (!_done.empty() && *_done.begin() == published)
+            {
+                _done.erase(_done.begin());
+                ++published;
+            }
+            _published = published;
+        }
+
+        uint64_t published() const
+        {
+            return _published;
+        }
+
+    private:
+        std::atomic<uint64_t> _next;
+        std::atomic<uint64_t> _published;
+        std::mutex _mutex;
+        std::set<uint64_t> _done;
+    };
+
+    struct options
+    {
+        std::string workloads = "abcdef";
+        uint64_t records = 100000;
+        uint64_t operations = 100000;
+        unsigned int threads = 1;
+        std::string filename = "ycsb_benchmark.db";
+    };
+
+    sqlite::db open(const std::string &filename)
+    {
+        sqlite::db db(filename, sqlite::threading_mode::MULTI_THREAD);
+        db.execute("PRAGMA journal_mode = WAL").fetch();
+        db.execute("PRAGMA synchronous = NORMAL");
+        db.execute("PRAGMA busy_timeout = 10000");
+
+        return db;
+    }
+
+    std::string fields_list()
+    {
+        std::string list;
+        for (int i = 0; i < fields; ++i)
+        {
+            list += (i ? ", field" : "field") + std::to_string(i);
+        }
+
+        return list;
+    }
+
+    void load(const options &options)
+    {
+        std::remove(options.filename.c_str());
+        std::remove((options.filename + "-wal").c_str());
+        std::remove((options.filename + "-shm").c_str());
+
+        auto db = open(options.filename);
+        std::string columns;
+        for (int i = 0; i < fields; ++i)
+        {
+            columns += ", field" + std::to_string(i) + " TEXT";
+        }
+        db.execute("CREATE TABLE usertable(ycsb_key TEXT PRIMARY KEY" + columns + ") WITHOUT ROWID");
+
+        auto statement = db.prepare("INSERT INTO usertable(ycsb_key, " + fields_list() + ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+        std::string value(field_size, 'x');
+        db.begin();
+        for (uint64_t i = 0; i < options.records; ++i)
+        {
+            statement.execute(key(i), value, value, value, value, value, value, value, value, value, value);
+        }
+        db.commit();
+    }
+
+    uint64_t percentile(const std::vector<uint64_t> &sorted, double p)
+    {
+        return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+    }
+
+    void run(const options &options, const workload &workload, bool last)
+    {
+        load(options);
+
+        zipfian keys(options.records);
+        insert_counter inserted(options.records);
+        std::vector<std::vector<std::vector<uint64_t>>> latencies(options.threads, std::vector<std::vector<uint64_t>>(OPERATIONS_COUNT));
+        std::vector<std::vector<uint64_t>> errors(options.threads, std::vector<uint64_t>(OPERATIONS_COUNT));
+        std::vector<std::exception_ptr> failures(options.threads);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < options.threads; ++t)
+        {
+            workers.emplace_back([&, t]
+            {
+                try
+                {
+                    auto db = open(options.filename);
+                    auto read_statement = db.prepare("SELECT " + fields_list() + " FROM usertable WHERE ycsb_key = ?");
+                    auto update_statement = db.prepare("UPDATE usertable SET field0 = ? WHERE ycsb_key = ?");
+                    auto insert_statement = db.prepare("INSERT INTO usertable(ycsb_key, " + fields_list() + ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+                    auto scan_statement = db.prepare("SELECT ycsb_key, " + fields_list() + " FROM usertable WHERE ycsb_key >= ? ORDER BY ycsb_key LIMIT ?");
+
+                    std::mt19937_64 random(t + 1);
+                    std::uniform_real_distribution<double> choice(0, 1);
+                    std::string value(field_size, 'y');
+                    std::string row[fields + 1];
+
+                    auto next_key = [&]
+                    {
+                        // "latest" favours recently inserted records, otherwise scrambled zipfian over loaded ones
+                        if (workload.latest)
+                        {
+                            auto last_inserted = inserted.published();
+                            return key(last_inserted - 1 - std::min(last_inserted - 1, keys(random)));
+                        }
+                        return key(fnv_hash(keys(random)) % options.records);
+                    };
+
+                    auto read = [&](const std::string &k)
+                    {
+                        read_statement.execute(k);
+                        read_statement.fetch(row[1], row[2], row[3], row[4], row[5], row[6], row[7], row[8], row[9], row[10]);
+                        read_statement.reset();
+                    };
+
+                    for (uint64_t i = t; i < options.operations; i += options.threads)
+                    {
+                        auto p = choice(random);
+                        int op = 0;
+                        while (op < OPERATIONS_COUNT - 1 && p >= workload.proportions[op])
+                        {
+                            p -= workload.proportions[op];
+                            ++op;
+                        }
+
+                        auto begin = std::chrono::steady_clock::now();
+                        try
+                        {
+                            switch (op)
+                            {
+                            case READ:
+                                read(next_key());
+                                break;
+                            case UPDATE:
+                                update_statement.execute(value, next_key());
+                                break;
+                            case INSERT:
+                            {
+                                auto number = inserted.next();
+                                try
+                                {
+                                    insert_statement.execute(key(number), value, value, value, value, value, value, value, value, value, value);
+                                }
+                                catch (...)
+                                {
+                                    inserted.acknowledge(number);
+                                    throw;
+                                }
+                                inserted.acknowledge(number);
+                                break;
+                            }
+                            case SCAN:
+                                scan_statement.execute(next_key(), static_cast<int64_t>(1 + random() % max_scan_length));
+                                while (scan_statement.fetch(row[0], row[1], row[2], row[3], row[4], row[5], row[6], row[7], row[8], row[9], row[10]))
+                                {
+                                }
+                                break;
+                            case READ_MODIFY_WRITE:
+                            {
+                                auto k = next_key();
+                                db.begin(sqlite::transaction_type::IMMEDIATE);
+                                read(k);
+                                update_statement.execute(value, k);
+                                db.commit();
+                                break;
+                            }
+                            }
+                        }
+                        catch (const sqlite::exception &)
+                        {
+                            ++errors[t][op];
+
+                            // a failed step is reported again by the next reset of its statement
+                            for (auto statement : {&read_statement, &update_statement, &insert_statement, &scan_statement})
+                            {
+                                try
+                                {
+                                    statement->reset();
+                                }
+                                catch (const sqlite::exception &)
+                                {
+                                }
+                            }
+                            if (!db.autocommit())
+                            {
+                                db.rollback();
+                            }
+                            continue;
+                        }
+                        latencies[t][op].push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count()));
+                    }
+                }
+                catch (...)
+                {
+                    failures[t] = std::current_exception();
+                }
+            });
+        }
+
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (const auto &failure : failures)
+        {
+            if (failure)
+            {
+                std::rethrow_exception(failure);
+            }
+        }
+
+        std::printf("    {\"workload\": \"%c\", \"records\": %llu, \"operations\": %llu, \"threads\": %u, \"throughput\": %.1f, \"latency_us\": {",
+            workload.name, static_cast<unsigned long long>(options.records), static_cast<unsigned long long>(options.operations), options.threads,
+            options.operations / elapsed);
+
+        bool first = true;
+        for (int op = 0; op < OPERATIONS_COUNT; ++op)
+        {
+            std::vector<uint64_t> all;
+            uint64_t failed = 0;
+            for (unsigned int t = 0; t < options.threads; ++t)
+            {
+                all.insert(all.end(), latencies[t][op].begin(), latencies[t][op].end());
+                failed += errors[t][op];
+            }
+            if (all.empty() && failed == 0)
+            {
+                continue;
+            }
+            std::sort(all.begin(), all.end());
+
+            std::printf("%s\"%s\": {\"count\": %zu, \"errors\": %llu, \"p50\": %.1f, \"p99\": %.1f, \"p999\": %.1f}", first ? "" : ", ", operation_names[op],
+                all.size(), static_cast<unsigned long long>(failed), percentile(all, 0.5) / 1e3, percentile(all, 0.99) / 1e3, percentile(all, 0.999) / 1e3);
+            first = false;
+        }
+        std::printf("}}%s\n", last ? "" : ",");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--workload")
+        {
+            options.workloads = argv[i + 1];
+        }
+        else if (arg == "--records")
+        {
+            options.records = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (arg == "--operations")
+        {
+            options.operations = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (arg == "--threads")
+        {
+            options.threads = static_cast<unsigned int>(std::max(1, std::atoi(argv[i + 1])));
+        }
+        else if (arg == "--db")
+        {
+            options.filename = argv[i + 1];
+        }
+    }
+
+    std::printf("{\n  \"sqlite_version\": \"%s\",\n  \"results\": [\n", sqlite3_libversion());
+    for (size_t i = 0; i < options.workloads.size(); ++i)
+    {
+        auto it = std::find_if(std::begin(workloads), std::end(workloads), [&](const workload &w) { return w.name == options.workloads[i]; });
+        if (it == std::end(workloads))
+        {
+            std::fprintf(stderr, "unknown workload %c\n", options.workloads[i]);
+            return 2;
+        }
+        try
+        {
+            run(options, *it, i + 1 == options.workloads.size());
+        }
+        catch (const std::exception &e)
+        {
+            std::fprintf(stderr, "workload %c failed: %s\n", it->name, e.what());
+            return 1;
+        }
+    }
+    std::printf("  ]\n}\n");
+
+    std::remove(options.filename.c_str());
+    std::remove((options.filename + "-wal").c_str());
+    std::remove((options.filename + "-shm").c_str());
+
+    return 0;
+}
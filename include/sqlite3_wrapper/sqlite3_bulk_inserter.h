@@ -0,0 +1,189 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <algorithm>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace sqlite3_wrapper
+{
+    namespace detail
+    {
+        // Row element type of an inserted argument, C strings are copied as the caller may reuse their buffers
+        template<class T>
+        struct stored
+        {
+            using type = typename std::decay<T>::type;
+
+            static const T &copy(const T &value)
+            {
+                return value;
+            }
+        };
+
+        template<>
+        struct stored<const char *>
+        {
+            using type = boost::optional<std::string>;
+
+            static type copy(const char *value)
+            {
+                return value ? type(value) : type();
+            }
+        };
+
+        template<>
+        struct stored<char *> : stored<const char *>
+        {
+        };
+    }
+
+    // Buffers rows and executes them in batches of batch_size, each batch in one transaction
+    // unless a transaction is already open. Callers must flush() before destruction to see errors:
+    // the destructor flushes pending rows too, but can only drop them if that fails.
+    template<class... Args>
+    class bulk_inserter
+    {
+    public:
+        using row = std::tuple<typename detail::stored<Args>::type...>;
+
+        bulk_inserter(db &db, const std::string &sql, size_t batch_size = 1000)
+            : _db(db)
+            , _statement(db.prepare(sql))
+            , _batch_size(batch_size)
+        {
+            _rows.reserve(batch_size);
+        }
+
+        bulk_inserter(const bulk_inserter &) = delete;
+        bulk_inserter &operator=(const bulk_inserter &) = delete;
+
+        ~bulk_inserter()
+        {
+            try
+            {
+                flush();
+            }
+            catch (...)
+            {
+            }
+        }
+
+        // Sorts every batch by the Index-th argument (the primary key) and keeps only the last row
+        // for duplicate keys, so inserts walk the B-tree sequentially instead of touching random pages
+        template<size_t Index>
+        void sort_by_key()
+        {
+            static_assert(!std::is_pointer<typename std::tuple_element<Index, row>::type>::value, "sort_by_key would compare pointer keys by address");
+
+            _less = [](const row &a, const row &b)
+            {
+                return std::get<Index>(a) < std::get<Index>(b);
+            };
+        }
+
+        void insert(const Args &... args)
+        {
+            _rows.emplace_back(detail::stored<Args>::copy(args)...);
+            if (_rows.size() >= _batch_size)
+            {
+                flush();
+            }
+        }
+
+        // On failure the batch stays buffered for the next flush(); inside a caller's transaction it must be
+        // rolled back before retrying, or the rows executed before the failure are inserted twice
+        void flush()
+        {
+            if (_rows.empty())
+            {
+                return;
+            }
+
+            if (_less)
+            {
+                sort_and_deduplicate();
+            }
+
+            auto own_transaction = _db.autocommit();
+            if (own_transaction)
+            {
+                _db.begin(transaction_type::IMMEDIATE);
+            }
+
+            try
+            {
+                for (const auto &row : _rows)
+                {
+                    execute(row, std::index_sequence_for<Args...>());
+                }
+            }
+            catch (...)
+            {
+                // clears the failed step so that the next execute does not report it again
+                sqlite3_reset(_statement.native_handle());
+                if (own_transaction)
+                {
+                    _db.rollback();
+                }
+                throw;
+            }
+
+            if (own_transaction)
+            {
+                _db.commit();
+            }
+            _rows.clear();
+        }
+
+        // Rows buffered since the last successful flush
+        size_t pending() const
+        {
+            return _rows.size();
+        }
+
+        // Drops the buffered rows, e.g. a batch that keeps failing
+        void discard()
+        {
+            _rows.clear();
+        }
+
+    private:
+        template<size_t... Indexes>
+        void execute(const row &row, std::index_sequence<Indexes...>)
+        {
+            _statement.execute(bind_policy::STATIC, std::get<Indexes>(row)...);
+        }
+
+        void sort_and_deduplicate()
+        {
+            std::stable_sort(_rows.begin(), _rows.end(), _less);
+
+            // rows with equal keys are adjacent in insertion order, the last one wins
+            size_t last = 0;
+            for (size_t i = 0; i < _rows.size(); ++i)
+            {
+                if (i + 1 < _rows.size() && !_less(_rows[i], _rows[i + 1]))
+                {
+                    continue;
+                }
+
+                if (last != i)
+                {
+                    _rows[last] = std::move(_rows[i]);
+                }
+                ++last;
+            }
+            _rows.erase(_rows.begin() + last, _rows.end());
+        }
+
+        db &_db;
+        statement _statement;
+        size_t _batch_size;
+        std::vector<row> _rows;
+        std::function<bool(const row &, const row &)> _less;
+    };
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <array>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <thread>
+
+namespace sqlite3_wrapper
+{
+    // Write-behind counters: add() aggregates deltas in memory, a background thread owning the connection
+    // flushes them every flush_interval as one UPSERT transaction. Callers shut down with flush(), which reports
+    // errors and keeps the deltas of a failed flush for the next one. The destructor flushes as well, deltas it
+    // fails to write are passed to the on_unflushed() handler or logged to stderr.
+    template<class K = std::string>
+    class counter_buffer
+    {
+    public:
+        using unflushed_handler = std::function<void(std::unordered_map<K, int64_t> deltas, std::exception_ptr error)>;
+
+        counter_buffer(db &&db, const std::string &table, std::chrono::milliseconds flush_interval = std::chrono::seconds(1))
+            : _db(std::move(db))
+            , _table(table)
+            , _flush_interval(flush_interval)
+        {
+            _db.execute("CREATE TABLE IF NOT EXISTS " + _table + "(key PRIMARY KEY NOT NULL, value INTEGER NOT NULL) WITHOUT ROWID");
+            _thread = std::thread(&counter_buffer::run, this);
+        }
+
+        counter_buffer(const counter_buffer &) = delete;
+        counter_buffer &operator=(const counter_buffer &) = delete;
+
+        ~counter_buffer()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopping = true;
+            }
+            _condition.notify_all();
+            _thread.join();
+
+            // a failed flush put its deltas back
+            auto deltas = take();
+            if (deltas.empty())
+            {
+                return;
+            }
+
+            try
+            {
+                if (_unflushed_handler)
+                {
+                    _unflushed_handler(std::move(deltas), _error);
+                }
+                else
+                {
+                    std::string reason = "unknown error";
+                    try
+                    {
+                        if (_error)
+                        {
+                            std::rethrow_exception(_error);
+                        }
+                    }
+                    catch (const std::exception &e)
+                    {
+                        reason = e.what();
+                    }
+                    catch (...)
+                    {
+                    }
+                    std::fprintf(stderr, "counter_buffer: %zu counters of %s lost: %s\n", deltas.size(), _table.c_str(), reason.c_str());
+                }
+            }
+            catch (...)
+            {
+            }
+        }
+
+        void add(const K &key, int64_t delta = 1)
+        {
+            auto &shard = _shards[std::hash<K>()(key) % shards_count];
+
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.deltas[key] += delta;
+        }
+
+        // Flushes everything added before the call, rethrows the error of that flush if it failed
+        void flush()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            auto ticket = ++_requested;
+            _condition.notify_all();
+            _flushed_condition.wait(lock, [this, ticket] { return _completed >= ticket; });
+
+            if (_error)
+            {
+                std::rethrow_exception(_error);
+            }
+        }
+
+        // Deltas added and not written yet, e.g. kept after a failed flush()
+        std::unordered_map<K, int64_t> pending() const
+        {
+            std::unordered_map<K, int64_t> deltas;
+            for (const auto &shard : _shards)
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                deltas.insert(shard.deltas.begin(), shard.deltas.end());
+            }
+
+            return deltas;
+        }
+
+        // Receives the deltas the final flush of the destructor could not write instead of the log line
+        void on_unflushed(unflushed_handler handler)
+        {
+            _unflushed_handler = std::move(handler);
+        }
+
+    private:
+        static constexpr size_t shards_count = 16;
+
+        struct shard
+        {
+            mutable std::mutex mutex;
+            std::unordered_map<K, int64_t> deltas;
+        };
+
+        void run()
+        {
+            _db.attach_to_current_thread();
+            auto upsert_statement = _db.prepare("INSERT INTO " + _table + "(key, value) VALUES (?, ?) ON CONFLICT(key) DO UPDATE SET value = value + excluded.value");
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            for (;;)
+            {
+                _condition.wait_for(lock, _flush_interval, [this] { return _stopping || _requested != _completed; });
+
+                auto stopping = _stopping;
+                auto ticket = _requested;
+                lock.unlock();
+
+                std::exception_ptr error;
+                try
+                {
+                    write(upsert_statement);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                lock.lock();
+                _error = error;
+                _completed = ticket;
+                _flushed_condition.notify_all();
+
+                if (stopping)
+                {
+                    break;
+                }
+            }
+        }
+
+        // Removes the deltas of all shards, keys are unique across shards
+        std::unordered_map<K, int64_t> take()
+        {
+            std::unordered_map<K, int64_t> deltas;
+            for (auto &shard : _shards)
+            {
+                std::unordered_map<K, int64_t> shard_deltas;
+                {
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    shard_deltas.swap(shard.deltas);
+                }
+
+                if (deltas.empty())
+                {
+                    deltas.swap(shard_deltas);
+                }
+                else
+                {
+                    deltas.insert(shard_deltas.begin(), shard_deltas.end());
+                }
+            }
+
+            return deltas;
+        }
+
+        void write(statement &upsert_statement)
+        {
+            auto deltas = take();
+            if (deltas.empty())
+            {
+                return;
+            }
+
+            try
+            {
+                _db.begin(transaction_type::IMMEDIATE);
+                for (const auto &delta : deltas)
+                {
+                    upsert_statement.execute(bind_policy::STATIC, delta.first, delta.second);
+                }
+                _db.commit();
+            }
+            catch (...)
+            {
+                // clears the failed step so that the next execute does not report it again
+                sqlite3_reset(upsert_statement.native_handle());
+                if (!_db.autocommit())
+                {
+                    _db.rollback();
+                }
+
+                // keep deltas for the next attempt
+                for (const auto &delta : deltas)
+                {
+                    add(delta.first, delta.second);
+                }
+                throw;
+            }
+        }
+
+        db _db;
+        std::string _table;
+        std::chrono::milliseconds _flush_interval;
+        std::array<shard, shards_count> _shards;
+
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::condition_variable _flushed_condition;
+        bool _stopping = false;
+        uint64_t _requested = 0;
+        uint64_t _completed = 0;
+        std::exception_ptr _error;
+        unflushed_handler _unflushed_handler;
+
+        std::thread _thread;
+    };
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace sqlite3_wrapper
+{
+    struct event
+    {
+        int64_t seq = 0;
+        std::string payload;
+    };
+
+    namespace detail
+    {
+        inline size_t read_events(statement &statement, int64_t after, size_t limit, std::vector<event> &events)
+        {
+            size_t count = 0;
+
+            statement.execute(after, static_cast<int64_t>(limit));
+            for (;;)
+            {
+                if (count == events.size())
+                {
+                    events.emplace_back();
+                }
+
+                if (!statement.fetch(events[count].seq, events[count].payload))
+                {
+                    break;
+                }
+                ++count;
+            }
+            statement.reset();
+
+            return count;
+        }
+    }
+
+    class tail_reader;
+
+    // Append-only log with monotonic sequence numbers. Tail readers are woken by commit notifications
+    // of the appending connection, readers in other processes fall back to PRAGMA data_version.
+    class event_log
+    {
+    public:
+        event_log(db &db, const std::string &name)
+            : _db(db)
+            , _name(create_table(db, name))
+            , _append_statement(_db.prepare("INSERT INTO " + _name + "(payload) VALUES (?)"))
+            , _read_statement(_db.prepare("SELECT seq, payload FROM " + _name + " WHERE seq > ? ORDER BY seq LIMIT ?"))
+        {
+            _db.commits();
+        }
+
+        event_log(const event_log &) = delete;
+        event_log &operator=(const event_log &) = delete;
+
+        int64_t append(const std::string &payload)
+        {
+            _append_statement.execute(bind_policy::STATIC, payload);
+            return _db.last_insert_rowid();
+        }
+
+        // Appends all payloads in one transaction unless a transaction is already open, returns the last sequence number
+        int64_t append(const std::vector<std::string> &payloads)
+        {
+            auto own_transaction = _db.autocommit();
+            if (own_transaction)
+            {
+                _db.begin(transaction_type::IMMEDIATE);
+            }
+
+            try
+            {
+                for (const auto &payload : payloads)
+                {
+                    _append_statement.execute(bind_policy::STATIC, payload);
+                }
+            }
+            catch (...)
+            {
+                if (own_transaction)
+                {
+                    _db.rollback();
+                }
+                throw;
+            }
+
+            if (own_transaction)
+            {
+                _db.commit();
+            }
+
+            return _db.last_insert_rowid();
+        }
+
+        // Reads up to limit events with seq > after into events, reusing its elements.
+        // Returns the number of events read, elements past it are left unspecified.
+        size_t read(int64_t after, size_t limit, std::vector<event> &events)
+        {
+            return detail::read_events(_read_statement, after, limit, events);
+        }
+
+        int64_t last_seq()
+        {
+            auto statement = _db.execute("SELECT IFNULL(MAX(seq), 0) FROM " + _name);
+
+            int64_t seq = 0;
+            statement.fetch(seq);
+
+            return seq;
+        }
+
+        inline tail_reader tail(db &reader_db, int64_t after = 0);
+
+    private:
+        static std::string create_table(db &db, const std::string &name)
+        {
+            db.execute("CREATE TABLE IF NOT EXISTS " + name + "(seq INTEGER PRIMARY KEY AUTOINCREMENT, payload BLOB)");
+            return name;
+        }
+
+        db &_db;
+        std::string _name;
+
+        statement _append_statement;
+        statement _read_statement;
+    };
+
+    // Follows an event log through its own connection, read() can block until new events are committed
+    class tail_reader
+    {
+    public:
+        // Reader for a log appended by another process, commits are detected via PRAGMA data_version
+        tail_reader(db &db, const std::string &name, int64_t after = 0)
+            : tail_reader(db, name, after, nullptr)
+        {
+        }
+
+        // writer_commits are notifications of the appending connection in this process, if any
+        tail_reader(db &db, const std::string &name, int64_t after, const commit_notifier *writer_commits)
+            : _db(db)
+            , _writer_commits(writer_commits)
+            , _after(after)
+            , _read_statement(_db.prepare("SELECT seq, payload FROM " + name + " WHERE seq > ? ORDER BY seq LIMIT ?"))
+        {
+            if (_writer_commits)
+            {
+                _generation = _writer_commits->generation();
+            }
+            _db.commits();
+        }
+
+        // Reads up to limit events past the last one read, waiting up to timeout for new commits when there are none
+        size_t read(size_t limit, std::vector<event> &events, std::chrono::milliseconds timeout = std::chrono::milliseconds(0))
+        {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+
+            for (;;)
+            {
+                auto count = detail::read_events(_read_statement, _after, limit, events);
+                if (count > 0)
+                {
+                    _after = events[count - 1].seq;
+                    return count;
+                }
+
+                if (!wait(deadline))
+                {
+                    return 0;
+                }
+            }
+        }
+
+        int64_t position() const
+        {
+            return _after;
+        }
+
+        // Interval of PRAGMA data_version checks while waiting, bounds latency of cross-process commits
+        void set_data_version_interval(std::chrono::milliseconds interval)
+        {
+            _data_version_interval = interval;
+        }
+
+    private:
+        bool wait(std::chrono::steady_clock::time_point deadline)
+        {
+            for (;;)
+            {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline)
+                {
+                    return false;
+                }
+
+                auto until = std::min(deadline, now + _data_version_interval);
+                if (_writer_commits)
+                {
+                    if (_writer_commits->wait_until(_generation, until))
+                    {
+                        _generation = _writer_commits->generation();
+                        return true;
+                    }
+                }
+                else
+                {
+                    std::this_thread::sleep_until(until);
+                }
+
+                if (_db.commits().check())
+                {
+                    return true;
+                }
+            }
+        }
+
+        db &_db;
+        const commit_notifier *_writer_commits;
+        uint64_t _generation = 0;
+        int64_t _after;
+        std::chrono::milliseconds _data_version_interval = std::chrono::milliseconds(10);
+
+        statement _read_statement;
+    };
+
+    tail_reader event_log::tail(db &reader_db, int64_t after)
+    {
+        return tail_reader(reader_db, _name, after, &_db.commits());
+    }
+}
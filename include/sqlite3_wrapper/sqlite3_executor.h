@@ -0,0 +1,320 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sqlite3_wrapper
+{
+    // Runs jobs on a pool of worker threads, each owning a connection, in priority classes (0 is the highest)
+    // with per-class concurrency limits. Long jobs of lower classes yield cooperatively: their progress handler
+    // runs waiting higher class jobs inline on the worker's second connection when no worker is idle. Jobs
+    // holding a write transaction do not yield, and the database should be in WAL mode so that the inline
+    // jobs are not blocked by the read lock of the suspended scan. The constructor returns once every worker
+    // has opened its connections and rethrows the first failure to open.
+    class query_executor
+    {
+    public:
+        using connection_factory = std::function<db()>;
+
+        // class_limits[i] > 0 is the maximum number of concurrently running jobs of class i, progress_interval
+        // is the number of virtual machine instructions between yield checks (0 disables yielding)
+        query_executor(connection_factory open, size_t workers, std::vector<size_t> class_limits, int progress_interval = 1000)
+            : _open(std::move(open))
+            , _progress_interval(progress_interval)
+            , _classes(class_limits.size())
+        {
+            if (workers == 0)
+            {
+                throw std::invalid_argument("query_executor needs workers");
+            }
+            if (class_limits.empty())
+            {
+                throw std::invalid_argument("query_executor needs priority classes");
+            }
+
+            for (size_t i = 0; i < class_limits.size(); ++i)
+            {
+                // jobs of a class without concurrency would never run and block the destructor
+                if (class_limits[i] == 0)
+                {
+                    throw std::invalid_argument("query_executor class " + std::to_string(i) + " has a concurrency limit of 0");
+                }
+                _classes[i].limit = class_limits[i];
+            }
+
+            try
+            {
+                for (size_t i = 0; i < workers; ++i)
+                {
+                    _threads.emplace_back(&query_executor::run, this);
+                }
+            }
+            catch (...)
+            {
+                stop();
+                throw;
+            }
+
+            std::exception_ptr error;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this] { return _started == _threads.size(); });
+                error = _start_error;
+            }
+            if (error)
+            {
+                stop();
+                std::rethrow_exception(error);
+            }
+        }
+
+        query_executor(const query_executor &) = delete;
+        query_executor &operator=(const query_executor &) = delete;
+
+        // Runs the queued jobs before returning
+        ~query_executor()
+        {
+            stop();
+        }
+
+        // f is called with the worker connection, the future carries its result or exception
+        template<class F>
+        auto submit(size_t priority, F &&f) -> std::future<decltype(f(std::declval<db &>()))>
+        {
+            using result = decltype(f(std::declval<db &>()));
+
+            if (priority >= _classes.size())
+            {
+                throw std::invalid_argument("unknown priority class " + std::to_string(priority));
+            }
+
+            auto task = std::make_shared<std::packaged_task<result(db &)>>(std::forward<F>(f));
+            auto future = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _classes[priority].queue.emplace_back([task](db &db) { (*task)(db); });
+                ++_classes[priority].queued;
+            }
+            _condition.notify_all();
+
+            return future;
+        }
+
+        size_t queued(size_t priority) const
+        {
+            return _classes.at(priority).queued;
+        }
+
+        size_t running(size_t priority) const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _classes.at(priority).running;
+        }
+
+        // Jobs of the class run inline by the progress handler of lower class jobs
+        uint64_t yielded(size_t priority) const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _classes.at(priority).yielded;
+        }
+
+    private:
+        using job = std::function<void(db &)>;
+
+        struct job_class
+        {
+            size_t limit = 0;
+            std::deque<job> queue;
+            // read without the lock by progress handlers
+            std::atomic<size_t> queued{0};
+            size_t running = 0;
+            uint64_t yielded = 0;
+        };
+
+        struct worker
+        {
+            query_executor *executor;
+            sqlite3 *primary;
+            db *spare;
+            // class of the job running on the primary connection
+            size_t priority = 0;
+            bool yielding = false;
+        };
+
+        // Highest class job with free concurrency among classes below end, must be called locked
+        bool take(size_t end, job &job, size_t &priority)
+        {
+            for (size_t i = 0; i < end; ++i)
+            {
+                auto &c = _classes[i];
+                if (!c.queue.empty() && c.running < c.limit)
+                {
+                    job = std::move(c.queue.front());
+                    c.queue.pop_front();
+                    --c.queued;
+                    ++c.running;
+                    priority = i;
+
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void finish(size_t priority)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                --_classes[priority].running;
+            }
+            // a freed class slot can unblock any waiting worker
+            _condition.notify_all();
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopping = true;
+            }
+            _condition.notify_all();
+
+            for (auto &thread : _threads)
+            {
+                thread.join();
+            }
+        }
+
+        void started(std::exception_ptr error)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                ++_started;
+                if (!_start_error)
+                {
+                    _start_error = error;
+                }
+            }
+            _condition.notify_all();
+        }
+
+        void run()
+        {
+            std::unique_ptr<db> primary_connection;
+            std::unique_ptr<db> spare;
+            try
+            {
+                primary_connection.reset(new db(_open()));
+                spare.reset(new db(_open()));
+                primary_connection->attach_to_current_thread();
+                spare->attach_to_current_thread();
+            }
+            catch (...)
+            {
+                started(std::current_exception());
+                return;
+            }
+            started(nullptr);
+
+            auto &primary = *primary_connection;
+            worker state{this, primary.native_handle(), spare.get()};
+            sqlite3_progress_handler(primary.native_handle(), _progress_interval, &query_executor::progress, &state);
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            for (;;)
+            {
+                job job;
+                size_t priority = 0;
+                ++_idle;
+                _condition.wait(lock, [&] { return take(_classes.size(), job, priority) || (_stopping && all_queues_empty()); });
+                --_idle;
+                if (!job)
+                {
+                    break;
+                }
+                lock.unlock();
+
+                state.priority = priority;
+                job(primary);
+                finish(priority);
+
+                lock.lock();
+            }
+            lock.unlock();
+
+            sqlite3_progress_handler(primary.native_handle(), 0, nullptr, nullptr);
+        }
+
+        bool all_queues_empty() const
+        {
+            return std::all_of(_classes.begin(), _classes.end(), [](const job_class &c) { return c.queue.empty(); });
+        }
+
+        static int progress(void *data)
+        {
+            auto &state = *static_cast<worker *>(data);
+            auto &executor = *state.executor;
+            if (state.yielding || state.priority == 0 || sqlite3_txn_state(state.primary, nullptr) == SQLITE_TXN_WRITE)
+            {
+                return 0;
+            }
+
+            bool waiting = false;
+            for (size_t i = 0; i < state.priority && !waiting; ++i)
+            {
+                waiting = executor._classes[i].queued > 0;
+            }
+            if (!waiting)
+            {
+                return 0;
+            }
+
+            // runs higher class jobs on the spare connection while the scan of this one is suspended
+            state.yielding = true;
+            for (;;)
+            {
+                job job;
+                size_t priority = 0;
+                {
+                    std::lock_guard<std::mutex> lock(executor._mutex);
+                    if (executor._idle > 0 || !executor.take(state.priority, job, priority))
+                    {
+                        break;
+                    }
+                    ++executor._classes[priority].yielded;
+                }
+
+                job(*state.spare);
+                executor.finish(priority);
+            }
+            state.yielding = false;
+
+            return 0;
+        }
+
+        connection_factory _open;
+        int _progress_interval;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _condition;
+        std::vector<job_class> _classes;
+        size_t _idle = 0;
+        bool _stopping = false;
+        size_t _started = 0;
+        std::exception_ptr _start_error;
+
+        std::vector<std::thread> _threads;
+    };
+}
@@ -0,0 +1,348 @@
+#pragma once
+
+#include "sqlite3_vfs_shim.h"
+
+#include <map>
+#include <random>
+
+namespace sqlite3_wrapper
+{
+    // Which unsynced writes and truncates of a file reach the disk on power loss
+    struct persistence_model
+    {
+        // probability that an unsynced change persisted, 0 loses all of them
+        double persist = 0.5;
+        // persist a prefix of uniformly random length of the unsynced changes in write order instead of a random subset,
+        // persist is not used then
+        bool prefix = false;
+        // probability that a persisted write is torn, only a random subset of its sectors persisted
+        double torn = 0.1;
+        int sector_size = 512;
+    };
+
+    // VFS shim simulating power loss for crash-consistency testing. Writes and truncates go through to the files
+    // and keep undo records until the file is synced. crash_after(n) fails the n-th following write and everything
+    // written after it, like a halted machine; power_loss() then reverts the unsynced changes of every file and
+    // replays the ones that persisted according to the persistence_model, drawn from a seeded generator.
+    // Deleting a file is treated as durable.
+    class power_loss_vfs : public vfs_shim
+    {
+    public:
+        explicit power_loss_vfs(const std::string &name = "power_loss", const char *base_vfs = nullptr, persistence_model model = persistence_model(),
+            uint64_t seed = 0)
+            : vfs_shim(name, base_vfs)
+            , _model(model)
+            , _random(seed)
+        {
+        }
+
+        void set_model(const persistence_model &model)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _model = model;
+        }
+
+        void seed(uint64_t seed)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _random.seed(seed);
+        }
+
+        // 0 disarms
+        void crash_after(uint64_t writes)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _crash_at = writes ? _writes + writes : 0;
+        }
+
+        bool crashed() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _crashed;
+        }
+
+        // Writes and truncates passed to the files so far
+        uint64_t writes() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _writes;
+        }
+
+        // Treats everything written so far as durable, e.g. after preparing the database
+        void settle()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto &file : _files)
+            {
+                file.second->undo.clear();
+            }
+        }
+
+        // Drops the unsynced changes of all files that did not persist and clears the crash; connections must be closed
+        void power_loss()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto &file : _files)
+            {
+                revert(file.first, *file.second);
+            }
+            _crashed = false;
+            _crash_at = 0;
+        }
+
+    protected:
+        void opened(vfs_file &file, const char *name) override
+        {
+            if (!name)
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto &log = _files[name];
+            if (!log)
+            {
+                log.reset(new file_log());
+            }
+            log->flags = file.flags;
+            file.state = log.get();
+        }
+
+        int write(vfs_file &file, const void *data, int amount, sqlite3_int64 offset) override
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!count_write())
+            {
+                return SQLITE_IOERR_WRITE;
+            }
+
+            if (file.state && !save_undo(file, offset, offset + amount, static_cast<const char *>(data), -1))
+            {
+                return SQLITE_IOERR_WRITE;
+            }
+
+            return vfs_shim::write(file, data, amount, offset);
+        }
+
+        int truncate(vfs_file &file, sqlite3_int64 size) override
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!count_write())
+            {
+                return SQLITE_IOERR_TRUNCATE;
+            }
+
+            sqlite3_int64 current = 0;
+            if (file.state && (file.real()->pMethods->xFileSize(file.real(), &current) != SQLITE_OK
+                || (size != current && !save_undo(file, std::min(size, current), std::max(size, current), nullptr, size))))
+            {
+                return SQLITE_IOERR_TRUNCATE;
+            }
+
+            return vfs_shim::truncate(file, size);
+        }
+
+        int sync(vfs_file &file, int flags) override
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_crashed)
+            {
+                return SQLITE_IOERR_FSYNC;
+            }
+
+            auto res = vfs_shim::sync(file, flags);
+            if (res == SQLITE_OK && file.state)
+            {
+                static_cast<file_log *>(file.state)->undo.clear();
+            }
+
+            return res;
+        }
+
+        int remove(const char *name, int sync_directory) override
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_crashed)
+            {
+                return SQLITE_IOERR_DELETE;
+            }
+
+            auto res = vfs_shim::remove(name, sync_directory);
+            auto file = _files.find(name);
+            if (res == SQLITE_OK && file != _files.end())
+            {
+                file->second->undo.clear();
+            }
+
+            return res;
+        }
+
+    private:
+        // Restores bytes [offset, offset + bytes.size()) and the file size as before a write or truncate,
+        // and replays the change with written or truncated_size
+        struct undo_record
+        {
+            sqlite3_int64 offset;
+            std::string bytes;
+            sqlite3_int64 size;
+            std::string written;
+            // -1 for writes
+            sqlite3_int64 truncated_size;
+        };
+
+        struct file_log
+        {
+            int flags = 0;
+            std::vector<undo_record> undo;
+        };
+
+        bool count_write()
+        {
+            if (_crashed)
+            {
+                return false;
+            }
+
+            ++_writes;
+            if (_crash_at && _writes >= _crash_at)
+            {
+                _crashed = true;
+                return false;
+            }
+
+            return true;
+        }
+
+        // written is the data of a write, truncated_size the new size of a truncate
+        static bool save_undo(vfs_file &file, sqlite3_int64 begin, sqlite3_int64 end, const char *written, sqlite3_int64 truncated_size)
+        {
+            undo_record record;
+            record.truncated_size = truncated_size;
+            if (written)
+            {
+                record.written.assign(written, static_cast<size_t>(end - begin));
+            }
+            if (file.real()->pMethods->xFileSize(file.real(), &record.size) != SQLITE_OK)
+            {
+                return false;
+            }
+
+            record.offset = begin;
+            if (begin < record.size)
+            {
+                record.bytes.resize(static_cast<size_t>(std::min(end, record.size) - begin));
+                if (file.real()->pMethods->xRead(file.real(), &record.bytes[0], static_cast<int>(record.bytes.size()), begin) != SQLITE_OK)
+                {
+                    return false;
+                }
+            }
+
+            static_cast<file_log *>(file.state)->undo.push_back(std::move(record));
+            return true;
+        }
+
+        void revert(const std::string &name, file_log &log)
+        {
+            if (log.undo.empty())
+            {
+                return;
+            }
+
+            int exists = 0;
+            base_vfs()->xAccess(base_vfs(), name.c_str(), SQLITE_ACCESS_EXISTS, &exists);
+            if (!exists)
+            {
+                log.undo.clear();
+                return;
+            }
+
+            std::vector<char> memory(static_cast<size_t>(base_vfs()->szOsFile));
+            auto real = reinterpret_cast<sqlite3_file *>(memory.data());
+            real->pMethods = nullptr;
+            auto flags = (log.flags & ~(SQLITE_OPEN_CREATE | SQLITE_OPEN_EXCLUSIVE | SQLITE_OPEN_DELETEONCLOSE | SQLITE_OPEN_READONLY)) | SQLITE_OPEN_READWRITE;
+            auto res = base_vfs()->xOpen(base_vfs(), name.c_str(), real, flags, nullptr);
+            if (res == SQLITE_OK)
+            {
+                for (auto record = log.undo.rbegin(); record != log.undo.rend(); ++record)
+                {
+                    if (!record->bytes.empty())
+                    {
+                        real->pMethods->xWrite(real, record->bytes.data(), static_cast<int>(record->bytes.size()), record->offset);
+                    }
+                    real->pMethods->xTruncate(real, record->size);
+                }
+
+                auto persisted = persisted_count(log.undo.size());
+                for (size_t i = 0; i < log.undo.size(); ++i)
+                {
+                    if (i < persisted && (_model.prefix || chance(_model.persist)))
+                    {
+                        replay(real, log.undo[i]);
+                    }
+                }
+            }
+            if (real->pMethods)
+            {
+                real->pMethods->xClose(real);
+            }
+            log.undo.clear();
+
+            if (res != SQLITE_OK)
+            {
+                throw std::runtime_error("failed to revert " + name);
+            }
+        }
+
+        bool chance(double probability)
+        {
+            return std::uniform_real_distribution<double>(0, 1)(_random) < probability;
+        }
+
+        // Changes that can persist in write order, all of them unless the model persists a prefix
+        size_t persisted_count(size_t changes)
+        {
+            if (!_model.prefix)
+            {
+                return changes;
+            }
+
+            return std::uniform_int_distribution<size_t>(0, changes)(_random);
+        }
+
+        void replay(sqlite3_file *real, const undo_record &record)
+        {
+            if (record.truncated_size >= 0)
+            {
+                real->pMethods->xTruncate(real, record.truncated_size);
+                return;
+            }
+
+            if (!chance(_model.torn))
+            {
+                real->pMethods->xWrite(real, record.written.data(), static_cast<int>(record.written.size()), record.offset);
+                return;
+            }
+
+            // sectors are aligned to the file offset, like the device writes them
+            auto sector = static_cast<sqlite3_int64>(std::max(1, _model.sector_size));
+            auto end = record.offset + static_cast<sqlite3_int64>(record.written.size());
+            for (auto begin = record.offset; begin < end;)
+            {
+                auto next = std::min(end, (begin / sector + 1) * sector);
+                if (chance(0.5))
+                {
+                    real->pMethods->xWrite(real, record.written.data() + (begin - record.offset), static_cast<int>(next - begin), begin);
+                }
+                begin = next;
+            }
+        }
+
+        mutable std::mutex _mutex;
+        persistence_model _model;
+        std::mt19937_64 _random;
+        std::map<std::string, std::unique_ptr<file_log>> _files;
+        uint64_t _writes = 0;
+        uint64_t _crash_at = 0;
+        bool _crashed = false;
+    };
+}
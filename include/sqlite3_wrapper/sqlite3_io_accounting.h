@@ -0,0 +1,179 @@
+#pragma once
+
+#include "sqlite3_vfs_shim.h"
+
+#include <map>
+
+namespace sqlite3_wrapper
+{
+    struct io_counters
+    {
+        uint64_t reads = 0;
+        uint64_t read_bytes = 0;
+        uint64_t writes = 0;
+        uint64_t write_bytes = 0;
+        uint64_t syncs = 0;
+        // memory-mapped page fetches, they cost page faults instead of read calls
+        uint64_t fetches = 0;
+
+        io_counters &operator+=(const io_counters &other)
+        {
+            reads += other.reads;
+            read_bytes += other.read_bytes;
+            writes += other.writes;
+            write_bytes += other.write_bytes;
+            syncs += other.syncs;
+            fetches += other.fetches;
+
+            return *this;
+        }
+    };
+
+    struct query_io
+    {
+        // empty for I/O outside of statement::step, e.g. while preparing statements or closing connections
+        std::string sql;
+        io_counters counters;
+    };
+
+    // VFS shim counting reads, writes, bytes and syncs of all files of connections opened through it
+    // (database, WAL, journals), attributed to the SQL of the statement being stepped on the thread
+    class io_accounting : public vfs_shim
+    {
+    public:
+        explicit io_accounting(const std::string &name = "io_accounting", const char *base_vfs = nullptr)
+            : vfs_shim(name, base_vfs)
+        {
+        }
+
+        // Queries ordered by transferred bytes
+        std::vector<query_io> queries() const
+        {
+            std::vector<query_io> queries;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                for (const auto &query : _queries)
+                {
+                    queries.push_back({query.first, query.second});
+                }
+            }
+
+            std::sort(queries.begin(), queries.end(), [](const query_io &a, const query_io &b)
+            {
+                return a.counters.read_bytes + a.counters.write_bytes > b.counters.read_bytes + b.counters.write_bytes;
+            });
+
+            return queries;
+        }
+
+        io_counters of(const std::string &sql) const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _queries.find(sql);
+
+            return it == _queries.end() ? io_counters() : it->second;
+        }
+
+        // Counters of the SQL of a statement, e.g. after executing it
+        io_counters of(statement &statement) const
+        {
+            auto sql = sqlite3_sql(statement.native_handle());
+            return of(sql ? sql : "");
+        }
+
+        io_counters total() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            io_counters total;
+            for (const auto &query : _queries)
+            {
+                total += query.second;
+            }
+
+            return total;
+        }
+
+        void reset()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queries.clear();
+        }
+
+        // Readable table of the queries with the most I/O
+        std::string report(size_t limit = 20) const
+        {
+            auto all = queries();
+            std::string report;
+            char line[160];
+            for (size_t i = 0; i < all.size() && i < limit; ++i)
+            {
+                const auto &c = all[i].counters;
+                std::snprintf(line, sizeof(line), "reads=%llu (%llu B) writes=%llu (%llu B) syncs=%llu fetches=%llu: ",
+                    static_cast<unsigned long long>(c.reads), static_cast<unsigned long long>(c.read_bytes), static_cast<unsigned long long>(c.writes),
+                    static_cast<unsigned long long>(c.write_bytes), static_cast<unsigned long long>(c.syncs), static_cast<unsigned long long>(c.fetches));
+                report += line + (all[i].sql.empty() ? std::string("<outside statements>") : all[i].sql) + "\n";
+            }
+
+            return report;
+        }
+
+    protected:
+        int read(vfs_file &file, void *data, int amount, sqlite3_int64 offset) override
+        {
+            auto res = vfs_shim::read(file, data, amount, offset);
+            record([amount](io_counters &counters)
+            {
+                ++counters.reads;
+                counters.read_bytes += static_cast<uint64_t>(amount);
+            });
+
+            return res;
+        }
+
+        int write(vfs_file &file, const void *data, int amount, sqlite3_int64 offset) override
+        {
+            auto res = vfs_shim::write(file, data, amount, offset);
+            record([amount](io_counters &counters)
+            {
+                ++counters.writes;
+                counters.write_bytes += static_cast<uint64_t>(amount);
+            });
+
+            return res;
+        }
+
+        int sync(vfs_file &file, int flags) override
+        {
+            auto res = vfs_shim::sync(file, flags);
+            record([](io_counters &counters) { ++counters.syncs; });
+
+            return res;
+        }
+
+        int fetch(vfs_file &file, sqlite3_int64 offset, int amount, void **data) override
+        {
+            auto res = vfs_shim::fetch(file, offset, amount, data);
+            if (*data)
+            {
+                record([](io_counters &counters) { ++counters.fetches; });
+            }
+
+            return res;
+        }
+
+    private:
+        template<class F>
+        void record(F &&update)
+        {
+            auto statement = detail::current_statement();
+            auto sql = statement ? sqlite3_sql(statement) : nullptr;
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            update(_queries[sql ? sql : ""]);
+        }
+
+        mutable std::mutex _mutex;
+        std::map<std::string, io_counters> _queries;
+    };
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <chrono>
+#include <vector>
+
+namespace sqlite3_wrapper
+{
+    struct job
+    {
+        int64_t id = 0;
+        std::string payload;
+        int attempts = 0;
+    };
+
+    // Durable queue in a single table, claimed jobs stay invisible for visibility_timeout and
+    // become claimable again unless acked. Jobs claimed more than max_attempts times are dead-lettered.
+    class job_queue
+    {
+    public:
+        job_queue(db &db, const std::string &name, std::chrono::milliseconds visibility_timeout = std::chrono::seconds(30), int max_attempts = 5)
+            : _db(db)
+            , _name(create_tables(db, name))
+            , _visibility_timeout(visibility_timeout)
+            , _max_attempts(max_attempts)
+            , _enqueue_statement(_db.prepare("INSERT INTO " + _name + "(payload, visible_at) VALUES (?, ?)"))
+            , _claim_statement(_db.prepare(R"(
+                UPDATE )" + _name + R"(
+                SET visible_at = ?1, attempts = attempts + 1
+                WHERE id IN (
+                    SELECT id
+                    FROM )" + _name + R"(
+                    WHERE state = 0 AND visible_at <= ?2
+                    ORDER BY visible_at
+                    LIMIT ?3
+                )
+                RETURNING id, payload, attempts
+            )"))
+            , _ack_statement(_db.prepare("DELETE FROM " + _name + " WHERE id = ? AND attempts = ? AND state = 0"))
+            , _nack_statement(_db.prepare(R"(
+                UPDATE )" + _name + R"(
+                SET visible_at = ?3, state = CASE WHEN attempts >= ?4 THEN 1 ELSE 0 END
+                WHERE id = ?1 AND attempts = ?2 AND state = 0
+            )"))
+            , _dead_letter_statement(_db.prepare("UPDATE " + _name + " SET state = 1 WHERE id = ? AND attempts = ?"))
+        {
+        }
+
+        job_queue(const job_queue &) = delete;
+        job_queue &operator=(const job_queue &) = delete;
+
+        int64_t enqueue(const std::string &payload, std::chrono::milliseconds delay = std::chrono::milliseconds(0))
+        {
+            _enqueue_statement.execute(bind_policy::STATIC, payload, now() + delay.count());
+            return _db.last_insert_rowid();
+        }
+
+        // Enqueues all payloads in one transaction unless a transaction is already open
+        void enqueue(const std::vector<std::string> &payloads, std::chrono::milliseconds delay = std::chrono::milliseconds(0))
+        {
+            auto own_transaction = _db.autocommit();
+            if (own_transaction)
+            {
+                _db.begin(transaction_type::IMMEDIATE);
+            }
+
+            try
+            {
+                auto visible_at = now() + delay.count();
+                for (const auto &payload : payloads)
+                {
+                    _enqueue_statement.execute(bind_policy::STATIC, payload, visible_at);
+                }
+            }
+            catch (...)
+            {
+                if (own_transaction)
+                {
+                    _db.rollback();
+                }
+                throw;
+            }
+
+            if (own_transaction)
+            {
+                _db.commit();
+            }
+        }
+
+        std::vector<job> claim(size_t count)
+        {
+            auto current = now();
+
+            std::vector<job> jobs;
+            std::vector<job> dead;
+            jobs.reserve(count);
+
+            _claim_statement.execute(current + _visibility_timeout.count(), current, static_cast<int64_t>(count));
+            job claimed;
+            while (_claim_statement.fetch(claimed.id, claimed.payload, claimed.attempts))
+            {
+                (claimed.attempts > _max_attempts ? dead : jobs).push_back(std::move(claimed));
+            }
+
+            // dead jobs are leased by this call, so nobody else can touch them in between
+            for (const auto &job : dead)
+            {
+                _dead_letter_statement.execute(job.id, job.attempts);
+            }
+
+            return jobs;
+        }
+
+        // Returns false if the visibility timeout expired and the job has been claimed again
+        bool ack(const job &job)
+        {
+            _ack_statement.execute(job.id, job.attempts);
+            return _db.changes() > 0;
+        }
+
+        // Returns the job to the queue, or dead-letters it if it has used all attempts
+        bool nack(const job &job, std::chrono::milliseconds delay = std::chrono::milliseconds(0))
+        {
+            _nack_statement.execute(job.id, job.attempts, now() + delay.count(), _max_attempts);
+            return _db.changes() > 0;
+        }
+
+        std::vector<job> dead_letters(size_t limit)
+        {
+            std::vector<job> jobs;
+
+            auto statement = _db.execute("SELECT id, payload, attempts FROM " + _name + " WHERE state = 1 ORDER BY id LIMIT ?", static_cast<int64_t>(limit));
+            job dead;
+            while (statement.fetch(dead.id, dead.payload, dead.attempts))
+            {
+                jobs.push_back(std::move(dead));
+            }
+
+            return jobs;
+        }
+
+    private:
+        static std::string create_tables(db &db, const std::string &name)
+        {
+            // state: 0 - ready or claimed until visible_at, 1 - dead letter
+            db.execute(R"(
+                CREATE TABLE IF NOT EXISTS )" + name + R"(
+                (
+                    id INTEGER PRIMARY KEY,
+                    payload BLOB,
+                    state INTEGER NOT NULL DEFAULT 0,
+                    visible_at INTEGER NOT NULL,
+                    attempts INTEGER NOT NULL DEFAULT 0
+                )
+            )");
+            db.execute("CREATE INDEX IF NOT EXISTS " + name + "_claim ON " + name + "(state, visible_at)");
+
+            return name;
+        }
+
+        static int64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        db &_db;
+        std::string _name;
+        std::chrono::milliseconds _visibility_timeout;
+        int _max_attempts;
+
+        statement _enqueue_statement;
+        statement _claim_statement;
+        statement _ack_statement;
+        statement _nack_statement;
+        statement _dead_letter_statement;
+    };
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace sqlite3_wrapper
+{
+    template<class K, class V>
+    class kv_store
+    {
+    public:
+        // cache_capacity > 0 enables in-process LRU cache in front of the table, kept coherent with
+        // writes through this store. Commits of other connections drop the cache once db.commits().check() sees them.
+        // Keys written inside a transaction are not cached until it ends, so a rollback can not leave them stale.
+        kv_store(db &db, const std::string &table, size_t cache_capacity = 0)
+            : _db(db)
+            , _table(create_table(db, table))
+            , _get_statement(_db.prepare("SELECT value FROM " + _table + " WHERE key = ?"))
+            , _put_statement(_db.prepare("INSERT INTO " + _table + "(key, value) VALUES (?, ?) ON CONFLICT(key) DO UPDATE SET value = excluded.value"))
+            , _erase_statement(_db.prepare("DELETE FROM " + _table + " WHERE key = ?"))
+            , _compare_and_swap_statement(_db.prepare("UPDATE " + _table + " SET value = ?3 WHERE key = ?1 AND value IS ?2"))
+            , _cache_capacity(cache_capacity)
+        {
+            if (_cache_capacity > 0)
+            {
+                _subscription = _db.commits().subscribe([this](const commit_event &event)
+                {
+                    if (event.source == commit_source::EXTERNAL)
+                    {
+                        clear_cache();
+                    }
+                });
+            }
+        }
+
+        kv_store(const kv_store &) = delete;
+        kv_store &operator=(const kv_store &) = delete;
+
+        ~kv_store()
+        {
+            if (_subscription)
+            {
+                _db.commits().unsubscribe(_subscription);
+            }
+        }
+
+        bool get(const K &key, V &value)
+        {
+            if (cache_lookup(key, value))
+            {
+                return true;
+            }
+
+            _get_statement.execute(bind_policy::STATIC, key);
+            auto found = _get_statement.fetch(value);
+            _get_statement.reset();
+
+            if (found)
+            {
+                cache_read(key, value);
+            }
+
+            return found;
+        }
+
+        boost::optional<V> get(const K &key)
+        {
+            V value;
+            if (get(key, value))
+            {
+                return value;
+            }
+
+            return boost::none;
+        }
+
+        std::vector<boost::optional<V>> get(const std::vector<K> &keys)
+        {
+            std::vector<boost::optional<V>> values(keys.size());
+            std::vector<size_t> missed;
+            missed.reserve(keys.size());
+
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                V value;
+                if (cache_lookup(keys[i], value))
+                {
+                    values[i] = std::move(value);
+                }
+                else
+                {
+                    missed.push_back(i);
+                }
+            }
+
+            for (size_t offset = 0; offset < missed.size(); offset += max_batch_size)
+            {
+                auto count = std::min(max_batch_size, missed.size() - offset);
+
+                // statements are cached per power of two bucket to keep their number small,
+                // unused placeholders of the bucket are padded with the last key
+                size_t bucket = 1;
+                while (bucket < count)
+                {
+                    bucket <<= 1;
+                }
+
+                auto &statement = batch_statement(bucket);
+                statement.reset();
+                for (size_t i = 0; i < bucket; ++i)
+                {
+                    statement.bind_value(static_cast<int>(i + 1), keys[missed[offset + std::min(i, count - 1)]], bind_policy::STATIC);
+                }
+
+                std::unordered_map<K, V> found;
+                K key;
+                V value;
+                while (statement.fetch(key, value))
+                {
+                    cache_read(key, value);
+                    found.emplace(std::move(key), std::move(value));
+                }
+                statement.reset();
+
+                for (size_t i = offset; i < offset + count; ++i)
+                {
+                    auto it = found.find(keys[missed[i]]);
+                    if (it != found.end())
+                    {
+                        values[missed[i]] = it->second;
+                    }
+                }
+            }
+
+            return values;
+        }
+
+        void put(const K &key, const V &value)
+        {
+            _put_statement.execute(bind_policy::STATIC, key, value);
+            cache_write(key, value);
+        }
+
+        bool erase(const K &key)
+        {
+            _erase_statement.execute(bind_policy::STATIC, key);
+            cache_write(key, boost::none);
+
+            return _db.changes() > 0;
+        }
+
+        bool compare_and_swap(const K &key, const V &expected, const V &desired)
+        {
+            _compare_and_swap_statement.execute(bind_policy::STATIC, key, expected, desired);
+            if (_db.changes() == 0)
+            {
+                cache_erase(key);
+                return false;
+            }
+
+            cache_write(key, desired);
+            return true;
+        }
+
+        void clear_cache()
+        {
+            _lru.clear();
+            _cache.clear();
+        }
+
+        // Keys written by the current transaction, bypassing the cache until it ends
+        size_t pending() const
+        {
+            return _pending.size();
+        }
+
+    private:
+        static constexpr size_t max_batch_size = 256;
+
+        static std::string create_table(db &db, const std::string &table)
+        {
+            db.execute("CREATE TABLE IF NOT EXISTS " + table + "(key PRIMARY KEY NOT NULL, value) WITHOUT ROWID");
+            return table;
+        }
+
+        statement &batch_statement(size_t bucket)
+        {
+            auto it = _batch_statements.find(bucket);
+            if (it == _batch_statements.end())
+            {
+                std::string sql = "SELECT key, value FROM " + _table + " WHERE key IN (?";
+                for (size_t i = 1; i < bucket; ++i)
+                {
+                    sql += ", ?";
+                }
+                sql += ")";
+
+                it = _batch_statements.emplace(bucket, _db.prepare(sql)).first;
+            }
+
+            return it->second;
+        }
+
+        // Forgets pending keys once the transaction that wrote them committed or rolled back
+        void settle_pending()
+        {
+            if (!_pending.empty() && _db.autocommit())
+            {
+                _pending.clear();
+            }
+        }
+
+        // Caches a value read from the table unless the current transaction wrote it
+        void cache_read(const K &key, const V &value)
+        {
+            settle_pending();
+            if (_pending.count(key) == 0)
+            {
+                cache_store(key, value);
+            }
+        }
+
+        // Caches a written value (none for erased keys) if it is committed
+        void cache_write(const K &key, const boost::optional<V> &value)
+        {
+            if (_cache_capacity == 0)
+            {
+                return;
+            }
+
+            settle_pending();
+            if (!_db.autocommit())
+            {
+                cache_erase(key);
+                _pending.insert(key);
+            }
+            else if (value)
+            {
+                cache_store(key, *value);
+            }
+            else
+            {
+                cache_erase(key);
+            }
+        }
+
+        bool cache_lookup(const K &key, V &value)
+        {
+            if (_cache_capacity == 0)
+            {
+                return false;
+            }
+
+            auto it = _cache.find(key);
+            if (it == _cache.end())
+            {
+                return false;
+            }
+
+            _lru.splice(_lru.begin(), _lru, it->second);
+            value = it->second->second;
+
+            return true;
+        }
+
+        void cache_store(const K &key, const V &value)
+        {
+            if (_cache_capacity == 0)
+            {
+                return;
+            }
+
+            auto it = _cache.find(key);
+            if (it != _cache.end())
+            {
+                it->second->second = value;
+                _lru.splice(_lru.begin(), _lru, it->second);
+                return;
+            }
+
+            if (_cache.size() >= _cache_capacity)
+            {
+                _cache.erase(_lru.back().first);
+                _lru.pop_back();
+            }
+
+            _lru.emplace_front(key, value);
+            _cache.emplace(key, _lru.begin());
+        }
+
+        void cache_erase(const K &key)
+        {
+            if (_cache_capacity == 0)
+            {
+                return;
+            }
+
+            auto it = _cache.find(key);
+            if (it != _cache.end())
+            {
+                _lru.erase(it->second);
+                _cache.erase(it);
+            }
+        }
+
+        db &_db;
+        std::string _table;
+
+        statement _get_statement;
+        statement _put_statement;
+        statement _erase_statement;
+        statement _compare_and_swap_statement;
+        std::map<size_t, statement> _batch_statements;
+
+        size_t _cache_capacity;
+        size_t _subscription = 0;
+        std::list<std::pair<K, V>> _lru;
+        std::unordered_map<K, typename std::list<std::pair<K, V>>::iterator> _cache;
+        std::unordered_set<K> _pending;
+    };
+}
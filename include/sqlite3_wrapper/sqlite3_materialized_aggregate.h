@@ -0,0 +1,208 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <vector>
+
+namespace sqlite3_wrapper
+{
+    // Aggregate table name(<group columns>, row_count, sum_<column>...) over a source table, kept current by
+    // generated AFTER INSERT/UPDATE/DELETE triggers within the writing transaction, so reads are primary key
+    // lookups. Only COUNT and SUM are maintained (AVG is sum / row_count): MIN and MAX can not be updated
+    // on delete without a scan. Source rows with a NULL group column are not aggregated, NULL values sum as 0.
+    // Rows removed by REPLACE conflict resolution fire DELETE triggers only with recursive_triggers, so it is
+    // enabled on db; other connections writing the source must enable it too.
+    class materialized_aggregate
+    {
+    public:
+        // The aggregate is backfilled from the source when its table is created, and rebuilt when its triggers
+        // were missing
+        materialized_aggregate(db &db, const std::string &name, const std::string &source, const std::vector<std::string> &group_by, const std::vector<std::string> &sums)
+            : _db(db)
+            , _name(name)
+            , _source(source)
+            , _group_by(group_by)
+            , _sums(sums)
+        {
+            if (_group_by.empty())
+            {
+                throw std::invalid_argument("materialized_aggregate " + _name + " needs group columns");
+            }
+
+            _db.execute("PRAGMA recursive_triggers = ON");
+
+            int64_t exists = 0;
+            _db.execute("SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = ?", _name).fetch(exists);
+            int64_t triggers = 0;
+            _db.execute("SELECT count(*) FROM sqlite_master WHERE type = 'trigger' AND name IN (?, ?, ?)",
+                _name + "_insert", _name + "_delete", _name + "_update").fetch(triggers);
+
+            std::string columns;
+            for (const auto &column : _group_by)
+            {
+                columns += column + " NOT NULL, ";
+            }
+            columns += "row_count INTEGER NOT NULL";
+            for (const auto &column : _sums)
+            {
+                columns += ", sum_" + column + " NOT NULL";
+            }
+
+            in_transaction([&]
+            {
+                _db.execute("CREATE TABLE IF NOT EXISTS " + _name + "(" + columns + ", PRIMARY KEY(" + join(_group_by, "") + ")) WITHOUT ROWID");
+                create_triggers();
+                if (exists && triggers < 3)
+                {
+                    // writes to the source since the triggers were dropped are missing from the aggregate
+                    _db.execute("DELETE FROM " + _name);
+                }
+                if (!exists || triggers < 3)
+                {
+                    backfill();
+                }
+            });
+        }
+
+        materialized_aggregate(const materialized_aggregate &) = delete;
+        materialized_aggregate &operator=(const materialized_aggregate &) = delete;
+
+        const std::string &name() const
+        {
+            return _name;
+        }
+
+        // Recomputes the aggregate from the source, e.g. after the source was written with triggers disabled
+        void rebuild()
+        {
+            in_transaction([&]
+            {
+                _db.execute("DELETE FROM " + _name);
+                backfill();
+            });
+        }
+
+        // Drops the triggers and the aggregate table
+        void drop()
+        {
+            in_transaction([&]
+            {
+                for (auto suffix : {"_insert", "_delete", "_update"})
+                {
+                    _db.execute("DROP TRIGGER IF EXISTS " + _name + suffix);
+                }
+                _db.execute("DROP TABLE IF EXISTS " + _name);
+            });
+        }
+
+    private:
+        static std::string join(const std::vector<std::string> &columns, const std::string &prefix, const std::string &separator = ", ")
+        {
+            std::string result;
+            for (const auto &column : columns)
+            {
+                result += (result.empty() ? "" : separator) + prefix + column;
+            }
+
+            return result;
+        }
+
+        std::string group_not_null(const std::string &row) const
+        {
+            return join(_group_by, row + ".", " IS NOT NULL AND ") + " IS NOT NULL";
+        }
+
+        // Trigger statement adding row (NEW or OLD) to its group
+        std::string add_row(const std::string &row) const
+        {
+            std::string sums_values;
+            std::string sums_update;
+            for (const auto &column : _sums)
+            {
+                sums_values += ", coalesce(" + row + "." + column + ", 0)";
+                sums_update += ", sum_" + column + " = sum_" + column + " + excluded.sum_" + column;
+            }
+
+            return "INSERT INTO " + _name + "(" + join(_group_by, "") + ", row_count" + (_sums.empty() ? "" : ", " + join(_sums, "sum_")) + ")"
+                + " SELECT " + join(_group_by, row + ".") + ", 1" + sums_values + " WHERE " + group_not_null(row)
+                + " ON CONFLICT(" + join(_group_by, "") + ") DO UPDATE SET row_count = row_count + 1" + sums_update + ";";
+        }
+
+        // Trigger statements removing row from its group, groups without rows are deleted
+        std::string remove_row(const std::string &row) const
+        {
+            std::string sums_update;
+            for (const auto &column : _sums)
+            {
+                sums_update += ", sum_" + column + " = sum_" + column + " - coalesce(" + row + "." + column + ", 0)";
+            }
+
+            std::string where;
+            for (const auto &column : _group_by)
+            {
+                where += (where.empty() ? "" : " AND ") + column + " = " + row + "." + column;
+            }
+
+            return "UPDATE " + _name + " SET row_count = row_count - 1" + sums_update + " WHERE " + where + ";"
+                + " DELETE FROM " + _name + " WHERE " + where + " AND row_count = 0;";
+        }
+
+        void create_triggers()
+        {
+            _db.execute("CREATE TRIGGER IF NOT EXISTS " + _name + "_insert AFTER INSERT ON " + _source + " BEGIN " + add_row("NEW") + " END");
+            _db.execute("CREATE TRIGGER IF NOT EXISTS " + _name + "_delete AFTER DELETE ON " + _source + " BEGIN " + remove_row("OLD") + " END");
+
+            auto columns = _group_by;
+            columns.insert(columns.end(), _sums.begin(), _sums.end());
+            _db.execute("CREATE TRIGGER IF NOT EXISTS " + _name + "_update AFTER UPDATE OF " + join(columns, "") + " ON " + _source
+                + " BEGIN " + remove_row("OLD") + " " + add_row("NEW") + " END");
+        }
+
+        void backfill()
+        {
+            std::string sums;
+            for (const auto &column : _sums)
+            {
+                sums += ", coalesce(sum(" + column + "), 0)";
+            }
+
+            _db.execute("INSERT INTO " + _name + " SELECT " + join(_group_by, "") + ", count(*)" + sums + " FROM " + _source
+                + " WHERE " + join(_group_by, "", " IS NOT NULL AND ") + " IS NOT NULL GROUP BY " + join(_group_by, ""));
+        }
+
+        // Runs f in a transaction unless one is already open
+        template<class F>
+        void in_transaction(F &&f)
+        {
+            auto own_transaction = _db.autocommit();
+            if (own_transaction)
+            {
+                _db.begin(transaction_type::IMMEDIATE);
+            }
+
+            try
+            {
+                f();
+            }
+            catch (...)
+            {
+                if (own_transaction)
+                {
+                    _db.rollback();
+                }
+                throw;
+            }
+
+            if (own_transaction)
+            {
+                _db.commit();
+            }
+        }
+
+        db &_db;
+        std::string _name;
+        std::string _source;
+        std::vector<std::string> _group_by;
+        std::vector<std::string> _sums;
+    };
+}
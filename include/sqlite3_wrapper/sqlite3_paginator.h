@@ -0,0 +1,224 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace sqlite3_wrapper
+{
+    namespace detail
+    {
+        inline std::string to_hex(const std::string &data)
+        {
+            static const char digits[] = "0123456789abcdef";
+
+            std::string hex;
+            hex.reserve(data.size() * 2);
+            for (unsigned char c : data)
+            {
+                hex += digits[c >> 4];
+                hex += digits[c & 0xf];
+            }
+
+            return hex;
+        }
+
+        inline std::string from_hex(const std::string &hex)
+        {
+            auto digit = [](char c) -> int
+            {
+                if (c >= '0' && c <= '9')
+                {
+                    return c - '0';
+                }
+                if (c >= 'a' && c <= 'f')
+                {
+                    return c - 'a' + 10;
+                }
+                throw std::invalid_argument("invalid cursor");
+            };
+
+            if (hex.size() % 2 != 0)
+            {
+                throw std::invalid_argument("invalid cursor");
+            }
+
+            std::string data;
+            data.reserve(hex.size() / 2);
+            for (size_t i = 0; i < hex.size(); i += 2)
+            {
+                data += static_cast<char>(digit(hex[i]) << 4 | digit(hex[i + 1]));
+            }
+
+            return data;
+        }
+
+        template<class Key>
+        typename std::enable_if<std::is_integral<Key>::value, std::string>::type encode_cursor(const Key &key)
+        {
+            return to_hex("i" + std::to_string(key));
+        }
+
+        inline std::string encode_cursor(const std::string &key)
+        {
+            return to_hex("s" + key);
+        }
+
+        template<class Key>
+        typename std::enable_if<std::is_integral<Key>::value>::type decode_cursor(const std::string &cursor, Key &key)
+        {
+            auto data = from_hex(cursor);
+            // only what encode_cursor writes: strtoll alone skips spaces and accepts '+'
+            if (data.size() < 2 || data[0] != 'i' || !((data[1] >= '0' && data[1] <= '9') || (std::is_signed<Key>::value && data[1] == '-')))
+            {
+                throw std::invalid_argument("invalid cursor");
+            }
+
+            auto text = data.c_str() + 1;
+            char *end = nullptr;
+            bool in_range;
+            errno = 0;
+            if constexpr (std::is_signed<Key>::value)
+            {
+                auto value = std::strtoll(text, &end, 10);
+                in_range = value >= std::numeric_limits<Key>::min() && value <= std::numeric_limits<Key>::max();
+                key = static_cast<Key>(value);
+            }
+            else
+            {
+                auto value = std::strtoull(text, &end, 10);
+                in_range = value <= std::numeric_limits<Key>::max();
+                key = static_cast<Key>(value);
+            }
+
+            if (errno == ERANGE || !in_range || end != data.c_str() + data.size())
+            {
+                throw std::invalid_argument("invalid cursor");
+            }
+        }
+
+        inline void decode_cursor(const std::string &cursor, std::string &key)
+        {
+            auto data = from_hex(cursor);
+            if (data.empty() || data[0] != 's')
+            {
+                throw std::invalid_argument("invalid cursor");
+            }
+
+            key = data.substr(1);
+        }
+    }
+
+    // Keyset pagination: pages are read with "WHERE key > ? ORDER BY key LIMIT ?" through cached statements,
+    // so every page costs O(log n + page size) regardless of its depth. Key must be unique.
+    template<class Key, class... Columns>
+    class paginator
+    {
+    public:
+        using row = std::tuple<Key, Columns...>;
+
+        struct page
+        {
+            std::vector<row> rows;
+            // opaque token of the next page, empty for the last page
+            std::string next_cursor;
+        };
+
+        // source is a table or view, columns are the selected columns besides the key matching Columns,
+        // filter is an optional condition without parameters
+        paginator(db &db, const std::string &source, const std::string &key, const std::string &columns, const std::string &filter = "", size_t page_size = 50)
+            : _first_page_statement(db.prepare(select(source, key, columns, filter, false)))
+            , _next_page_statement(db.prepare(select(source, key, columns, filter, true)))
+            , _page_size(page_size)
+        {
+            if (page_size == 0)
+            {
+                throw std::invalid_argument("paginator needs a page size");
+            }
+        }
+
+        // Reads the page starting after cursor, an empty cursor is the first page
+        page fetch(const std::string &cursor = "")
+        {
+            page result;
+            fetch(cursor, result);
+
+            return result;
+        }
+
+        // Reads the page into result reusing its storage
+        void fetch(const std::string &cursor, page &result)
+        {
+            // one extra row tells whether there is a next page
+            auto limit = static_cast<int64_t>(_page_size + 1);
+            auto &statement = cursor.empty() ? _first_page_statement : _next_page_statement;
+            if (cursor.empty())
+            {
+                statement.execute(limit);
+            }
+            else
+            {
+                Key after;
+                detail::decode_cursor(cursor, after);
+                statement.execute(after, limit);
+            }
+
+            size_t count = 0;
+            for (;;)
+            {
+                if (count == result.rows.size())
+                {
+                    result.rows.emplace_back();
+                }
+
+                if (!fetch_row(statement, result.rows[count], std::index_sequence_for<Key, Columns...>()))
+                {
+                    break;
+                }
+                ++count;
+            }
+            statement.reset();
+
+            result.next_cursor.clear();
+            if (count > _page_size)
+            {
+                count = _page_size;
+                result.next_cursor = detail::encode_cursor(std::get<0>(result.rows[count - 1]));
+            }
+            result.rows.resize(count);
+        }
+
+    private:
+        static std::string select(const std::string &source, const std::string &key, const std::string &columns, const std::string &filter, bool after)
+        {
+            std::string sql = "SELECT " + key + (columns.empty() ? "" : ", " + columns) + " FROM " + source;
+
+            std::string where = filter.empty() ? "" : "(" + filter + ")";
+            if (after)
+            {
+                where += (where.empty() ? "" : " AND ") + key + " > ?";
+            }
+            if (!where.empty())
+            {
+                sql += " WHERE " + where;
+            }
+
+            return sql + " ORDER BY " + key + " LIMIT ?";
+        }
+
+        template<size_t... Indexes>
+        static bool fetch_row(statement &statement, row &row, std::index_sequence<Indexes...>)
+        {
+            return statement.fetch(std::get<Indexes>(row)...);
+        }
+
+        statement _first_page_statement;
+        statement _next_page_statement;
+        size_t _page_size;
+    };
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <atomic>
+#include <deque>
+#include <future>
+#include <thread>
+
+namespace sqlite3_wrapper
+{
+    // Connection of a read_executor worker with the statements prepared by its jobs
+    class cached_connection
+    {
+    public:
+        explicit cached_connection(db db)
+            : _db(std::move(db))
+        {
+        }
+
+        cached_connection(const cached_connection &) = delete;
+        cached_connection &operator=(const cached_connection &) = delete;
+
+        db &connection()
+        {
+            return _db;
+        }
+
+        // Statement for sql, prepared on first use and kept for the lifetime of the connection
+        statement &prepare(const std::string &sql)
+        {
+            auto it = _statements.find(sql);
+            if (it == _statements.end())
+            {
+                it = _statements.emplace(sql, _db.prepare(sql)).first;
+            }
+            _used.push_back(&it->second);
+
+            return it->second;
+        }
+
+        template<class... Args>
+        statement &execute(const std::string &sql, const Args &... args)
+        {
+            auto &statement = prepare(sql);
+            statement.execute(args...);
+
+            return statement;
+        }
+
+        size_t size() const
+        {
+            return _statements.size();
+        }
+
+        // Resets the statements used since the last call so that no read transaction outlives a job
+        void release()
+        {
+            for (auto statement : _used)
+            {
+                statement->try_reset();
+            }
+            _used.clear();
+        }
+
+    private:
+        db _db;
+        std::unordered_map<std::string, statement> _statements;
+        std::vector<statement *> _used;
+    };
+
+    // Runs read jobs on worker threads, each owning a connection with a warm statement cache and a deque of jobs.
+    // Jobs are queued round robin or to a chosen worker, a worker runs its own jobs oldest first and, once they
+    // are done, steals the oldest jobs of the other workers, so slow jobs do not leave backlogs behind idle workers.
+    // The constructor returns once every worker has opened its connection and rethrows the first failure to open.
+    class read_executor
+    {
+    public:
+        using connection_factory = std::function<db()>;
+
+        // steal = false keeps jobs on the worker they were queued to
+        read_executor(connection_factory open, size_t workers, bool steal = true)
+            : _open(std::move(open))
+            , _steal(steal)
+            , _queues(workers)
+        {
+            if (workers == 0)
+            {
+                throw std::invalid_argument("read_executor needs workers");
+            }
+
+            try
+            {
+                for (size_t i = 0; i < workers; ++i)
+                {
+                    _threads.emplace_back(&read_executor::run, this, i);
+                }
+            }
+            catch (...)
+            {
+                stop();
+                throw;
+            }
+
+            std::exception_ptr error;
+            {
+                std::unique_lock<std::mutex> lock(_idle_mutex);
+                _idle_condition.wait(lock, [this] { return _started == _threads.size(); });
+                error = _start_error;
+            }
+            if (error)
+            {
+                stop();
+                std::rethrow_exception(error);
+            }
+        }
+
+        read_executor(const read_executor &) = delete;
+        read_executor &operator=(const read_executor &) = delete;
+
+        // Runs the queued jobs before returning
+        ~read_executor()
+        {
+            stop();
+        }
+
+        size_t workers() const
+        {
+            return _queues.size();
+        }
+
+        // f is called with the worker connection, the future carries its result or exception
+        template<class F>
+        auto submit(F &&f) -> std::future<decltype(f(std::declval<cached_connection &>()))>
+        {
+            return submit_to(_next++ % _queues.size(), std::forward<F>(f));
+        }
+
+        // Queues f to a worker, e.g. chosen by key so that its statements and pages are warm
+        template<class F>
+        auto submit_to(size_t worker, F &&f) -> std::future<decltype(f(std::declval<cached_connection &>()))>
+        {
+            using result = decltype(f(std::declval<cached_connection &>()));
+
+            auto task = std::make_shared<std::packaged_task<result(cached_connection &)>>(std::forward<F>(f));
+            auto future = task->get_future();
+            {
+                auto &queue = _queues.at(worker);
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.jobs.emplace_back([task](cached_connection &connection) { (*task)(connection); });
+                ++queue.size;
+                ++_pending;
+            }
+            {
+                // orders the push before the wait predicate of sleeping workers
+                std::lock_guard<std::mutex> lock(_idle_mutex);
+            }
+            if (_steal)
+            {
+                _idle_condition.notify_one();
+            }
+            else
+            {
+                _idle_condition.notify_all();
+            }
+
+            return future;
+        }
+
+        // Jobs run by another worker than the one they were queued to
+        uint64_t stolen() const
+        {
+            return _stolen;
+        }
+
+    private:
+        using job = std::function<void(cached_connection &)>;
+
+        struct queue
+        {
+            std::mutex mutex;
+            std::deque<job> jobs;
+            std::atomic<size_t> size{0};
+        };
+
+        bool pop(size_t worker, job &job)
+        {
+            auto &queue = _queues[worker];
+            if (queue.size == 0)
+            {
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty())
+            {
+                return false;
+            }
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            --queue.size;
+            --_pending;
+
+            return true;
+        }
+
+        // Takes the oldest job of the first other worker with a backlog, it has waited longest behind the job
+        // the owner is running
+        bool steal(size_t worker, job &job)
+        {
+            for (size_t i = 1; i < _queues.size(); ++i)
+            {
+                auto &queue = _queues[(worker + i) % _queues.size()];
+                if (queue.size == 0)
+                {
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.jobs.empty())
+                {
+                    job = std::move(queue.jobs.front());
+                    queue.jobs.pop_front();
+                    --queue.size;
+                    --_pending;
+                    ++_stolen;
+
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_idle_mutex);
+                _stopping = true;
+            }
+            _idle_condition.notify_all();
+
+            for (auto &thread : _threads)
+            {
+                thread.join();
+            }
+        }
+
+        void started(std::exception_ptr error)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_idle_mutex);
+                ++_started;
+                if (!_start_error)
+                {
+                    _start_error = error;
+                }
+            }
+            _idle_condition.notify_all();
+        }
+
+        bool has_work(size_t worker) const
+        {
+            return _steal ? _pending > 0 : _queues[worker].size > 0;
+        }
+
+        void run(size_t worker)
+        {
+            std::unique_ptr<cached_connection> connection;
+            try
+            {
+                connection.reset(new cached_connection(_open()));
+                connection->connection().attach_to_current_thread();
+            }
+            catch (...)
+            {
+                started(std::current_exception());
+                return;
+            }
+            started(nullptr);
+
+            for (;;)
+            {
+                job job;
+                if (pop(worker, job) || (_steal && steal(worker, job)))
+                {
+                    job(*connection);
+                    connection->release();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(_idle_mutex);
+                _idle_condition.wait(lock, [&] { return has_work(worker) || _stopping; });
+                if (_stopping && !has_work(worker))
+                {
+                    break;
+                }
+            }
+        }
+
+        connection_factory _open;
+        bool _steal;
+
+        std::vector<queue> _queues;
+        std::atomic<size_t> _next{0};
+        std::atomic<size_t> _pending{0};
+        std::atomic<uint64_t> _stolen{0};
+
+        std::mutex _idle_mutex;
+        std::condition_variable _idle_condition;
+        bool _stopping = false;
+        size_t _started = 0;
+        std::exception_ptr _start_error;
+
+        std::vector<std::thread> _threads;
+    };
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace sqlite3_wrapper
+{
+    // Named in-memory database shared by connections of this process (file:name?mode=memory&cache=shared),
+    // it lives as long as the anchor connection or any connection made by connect()
+    class shared_memory_db
+    {
+    public:
+        explicit shared_memory_db(const std::string &name)
+            : _uri(detail::file_uri(name) + "?mode=memory&cache=shared")
+            , _anchor(_uri, threading_mode::SERIALIZED, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI)
+        {
+        }
+
+        db connect(threading_mode mode = threading_mode::MULTI_THREAD, int flags = SQLITE_OPEN_READWRITE) const
+        {
+            return db(_uri, mode, flags | SQLITE_OPEN_URI);
+        }
+
+        db &anchor()
+        {
+            return _anchor;
+        }
+
+        const std::string &uri() const
+        {
+            return _uri;
+        }
+
+    private:
+        std::string _uri;
+        db _anchor;
+    };
+
+    // Read-mostly shared in-memory cache. refresh() loads a complete new generation into a separate
+    // shared memory database and publishes it, readers switch to it on their next connection() call,
+    // so they neither block on the writer (shared cache table locks) nor see a partial refresh.
+    // Generations are named after the cache name and an instance number, caches sharing a name stay apart.
+    class shared_memory_cache
+    {
+        struct generation
+        {
+            generation(const std::string &name, uint64_t number)
+                : number(number)
+                , database(name + "_" + std::to_string(number))
+            {
+            }
+
+            uint64_t number;
+            shared_memory_db database;
+        };
+
+    public:
+        class reader
+        {
+        public:
+            explicit reader(const shared_memory_cache &cache)
+                : _cache(cache)
+            {
+            }
+
+            // Connection to the latest generation, statements prepared on it are invalidated when generation() changes
+            db &connection()
+            {
+                if (!_generation || _generation->number != _cache._last_generation.load(std::memory_order_acquire))
+                {
+                    _connection.reset();
+                    _generation = _cache.current();
+                    if (!_generation)
+                    {
+                        throw std::logic_error("shared_memory_cache is not loaded");
+                    }
+
+                    _connection.reset(new db(_generation->database.connect(threading_mode::MULTI_THREAD, SQLITE_OPEN_READONLY)));
+                }
+
+                return *_connection;
+            }
+
+            uint64_t generation() const
+            {
+                return _generation ? _generation->number : 0;
+            }
+
+        private:
+            const shared_memory_cache &_cache;
+            std::shared_ptr<const shared_memory_cache::generation> _generation;
+            std::unique_ptr<db> _connection;
+        };
+
+        explicit shared_memory_cache(const std::string &name)
+            : _name(name + "_" + std::to_string(++instances()))
+        {
+        }
+
+        // Runs loader inside a transaction on a new generation and publishes it, returns its number
+        uint64_t refresh(const std::function<void(db &)> &loader)
+        {
+            std::lock_guard<std::mutex> refresh_lock(_refresh_mutex);
+
+            auto next = std::make_shared<generation>(_name, _last_generation.load() + 1);
+            auto &db = next->database.anchor();
+            db.begin();
+            try
+            {
+                loader(db);
+            }
+            catch (...)
+            {
+                db.rollback();
+                throw;
+            }
+            db.commit();
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _current = next;
+            }
+            _last_generation.store(next->number, std::memory_order_release);
+
+            return next->number;
+        }
+
+        reader make_reader() const
+        {
+            return reader(*this);
+        }
+
+    private:
+        static std::atomic<uint64_t> &instances()
+        {
+            static std::atomic<uint64_t> instances{0};
+            return instances;
+        }
+
+        std::shared_ptr<const generation> current() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _current;
+        }
+
+        std::string _name;
+        std::mutex _refresh_mutex;
+        mutable std::mutex _mutex;
+        std::shared_ptr<const generation> _current;
+        std::atomic<uint64_t> _last_generation{0};
+    };
+}
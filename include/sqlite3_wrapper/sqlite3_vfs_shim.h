@@ -0,0 +1,289 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <new>
+
+namespace sqlite3_wrapper
+{
+    class vfs_shim;
+
+    struct vfs_file
+    {
+        // must be first, SQLite sees vfs_file as sqlite3_file
+        sqlite3_file base;
+        vfs_shim *shim;
+        // SQLITE_OPEN_* flags of xOpen, e.g. SQLITE_OPEN_MAIN_DB
+        int flags;
+        // owned by the shim, set in opened() and released in closing()
+        void *state;
+
+        // file of the underlying VFS, allocated right after this one
+        sqlite3_file *real()
+        {
+            return reinterpret_cast<sqlite3_file *>(this + 1);
+        }
+    };
+
+    // Base of VFS shims registered over another VFS (the default one by default). Virtual methods intercept
+    // file operations and forward to the underlying VFS by default; they are called concurrently from all
+    // connections using the shim. Connections select it by name: db(filename, flags, shim.name()).
+    // The shim must outlive those connections. Exceptions never unwind through SQLite: they fail the
+    // operation with SQLITE_NOMEM for std::bad_alloc and SQLITE_CANTOPEN or SQLITE_IOERR_* otherwise.
+    class vfs_shim
+    {
+    public:
+        explicit vfs_shim(const std::string &name, const char *base_vfs = nullptr, bool make_default = false)
+            : _name(name)
+            , _base(sqlite3_vfs_find(base_vfs))
+        {
+            if (!_base)
+            {
+                throw std::runtime_error("VFS " + std::string(base_vfs ? base_vfs : "default") + " is not found");
+            }
+
+            _vfs.iVersion = std::min(_base->iVersion, 3);
+            _vfs.szOsFile = static_cast<int>(sizeof(vfs_file)) + _base->szOsFile;
+            _vfs.mxPathname = _base->mxPathname;
+            _vfs.zName = _name.c_str();
+            _vfs.pAppData = this;
+            _vfs.xOpen = &vfs_shim::vfs_open;
+            _vfs.xDelete = &vfs_shim::vfs_delete;
+            _vfs.xAccess = [](sqlite3_vfs *vfs, const char *name, int flags, int *result) { return base(vfs)->xAccess(base(vfs), name, flags, result); };
+            _vfs.xFullPathname = [](sqlite3_vfs *vfs, const char *name, int size, char *out) { return base(vfs)->xFullPathname(base(vfs), name, size, out); };
+            _vfs.xDlOpen = [](sqlite3_vfs *vfs, const char *name) { return base(vfs)->xDlOpen(base(vfs), name); };
+            _vfs.xDlError = [](sqlite3_vfs *vfs, int size, char *message) { base(vfs)->xDlError(base(vfs), size, message); };
+            _vfs.xDlSym = [](sqlite3_vfs *vfs, void *handle, const char *symbol) { return base(vfs)->xDlSym(base(vfs), handle, symbol); };
+            _vfs.xDlClose = [](sqlite3_vfs *vfs, void *handle) { base(vfs)->xDlClose(base(vfs), handle); };
+            _vfs.xRandomness = [](sqlite3_vfs *vfs, int size, char *out) { return base(vfs)->xRandomness(base(vfs), size, out); };
+            _vfs.xSleep = [](sqlite3_vfs *vfs, int microseconds) { return base(vfs)->xSleep(base(vfs), microseconds); };
+            _vfs.xCurrentTime = [](sqlite3_vfs *vfs, double *time) { return base(vfs)->xCurrentTime(base(vfs), time); };
+            _vfs.xGetLastError = [](sqlite3_vfs *vfs, int size, char *message) { return base(vfs)->xGetLastError(base(vfs), size, message); };
+            if (_vfs.iVersion >= 2)
+            {
+                _vfs.xCurrentTimeInt64 = [](sqlite3_vfs *vfs, sqlite3_int64 *time) { return base(vfs)->xCurrentTimeInt64(base(vfs), time); };
+            }
+            if (_vfs.iVersion >= 3)
+            {
+                _vfs.xSetSystemCall = [](sqlite3_vfs *vfs, const char *name, sqlite3_syscall_ptr call) { return base(vfs)->xSetSystemCall(base(vfs), name, call); };
+                _vfs.xGetSystemCall = [](sqlite3_vfs *vfs, const char *name) { return base(vfs)->xGetSystemCall(base(vfs), name); };
+                _vfs.xNextSystemCall = [](sqlite3_vfs *vfs, const char *name) { return base(vfs)->xNextSystemCall(base(vfs), name); };
+            }
+
+            if (sqlite3_vfs_register(&_vfs, make_default ? 1 : 0) != SQLITE_OK)
+            {
+                throw std::runtime_error("failed to register VFS " + _name);
+            }
+        }
+
+        vfs_shim(const vfs_shim &) = delete;
+        vfs_shim &operator=(const vfs_shim &) = delete;
+
+        virtual ~vfs_shim()
+        {
+            sqlite3_vfs_unregister(&_vfs);
+        }
+
+        const std::string &name() const
+        {
+            return _name;
+        }
+
+    protected:
+        // Called after the underlying file is opened, name is null for temporary files
+        virtual void opened(vfs_file &, const char *)
+        {
+        }
+
+        virtual void closing(vfs_file &)
+        {
+        }
+
+        virtual int read(vfs_file &file, void *data, int amount, sqlite3_int64 offset)
+        {
+            return file.real()->pMethods->xRead(file.real(), data, amount, offset);
+        }
+
+        virtual int write(vfs_file &file, const void *data, int amount, sqlite3_int64 offset)
+        {
+            return file.real()->pMethods->xWrite(file.real(), data, amount, offset);
+        }
+
+        virtual int truncate(vfs_file &file, sqlite3_int64 size)
+        {
+            return file.real()->pMethods->xTruncate(file.real(), size);
+        }
+
+        virtual int sync(vfs_file &file, int flags)
+        {
+            return file.real()->pMethods->xSync(file.real(), flags);
+        }
+
+        // Memory-mapped reads, *data set to null falls back to read()
+        virtual int fetch(vfs_file &file, sqlite3_int64 offset, int amount, void **data)
+        {
+            return file.real()->pMethods->xFetch(file.real(), offset, amount, data);
+        }
+
+        virtual int remove(const char *name, int sync_directory)
+        {
+            return _base->xDelete(_base, name, sync_directory);
+        }
+
+        sqlite3_vfs *base_vfs() const
+        {
+            return _base;
+        }
+
+    private:
+        static sqlite3_vfs *base(sqlite3_vfs *vfs)
+        {
+            return static_cast<vfs_shim *>(vfs->pAppData)->_base;
+        }
+
+        static vfs_file &to_file(sqlite3_file *file)
+        {
+            return *reinterpret_cast<vfs_file *>(file);
+        }
+
+        static sqlite3_file *real(sqlite3_file *file)
+        {
+            return reinterpret_cast<vfs_file *>(file)->real();
+        }
+
+        template <typename F>
+        static int guarded(int error, F &&f) noexcept
+        {
+            try
+            {
+                return f();
+            }
+            catch (const std::bad_alloc &)
+            {
+                return SQLITE_NOMEM;
+            }
+            catch (...)
+            {
+                return error;
+            }
+        }
+
+        static int vfs_open(sqlite3_vfs *vfs, const char *name, sqlite3_file *base_file, int flags, int *out_flags)
+        {
+            auto shim = static_cast<vfs_shim *>(vfs->pAppData);
+            auto &f = to_file(base_file);
+            f.base.pMethods = nullptr;
+            f.shim = shim;
+            f.flags = flags;
+            f.state = nullptr;
+
+            auto res = shim->_base->xOpen(shim->_base, name, f.real(), flags, out_flags);
+            if (f.real()->pMethods)
+            {
+                // SQLite calls xClose whenever pMethods is set, even if xOpen failed
+                f.base.pMethods = &io_methods;
+                if (res == SQLITE_OK)
+                {
+                    res = guarded(SQLITE_CANTOPEN, [shim, &f, name] { shim->opened(f, name); return SQLITE_OK; });
+                    if (res != SQLITE_OK)
+                    {
+                        // closed here without closing(), SQLite does not call xClose without pMethods
+                        f.real()->pMethods->xClose(f.real());
+                        f.base.pMethods = nullptr;
+                    }
+                }
+            }
+
+            return res;
+        }
+
+        static int vfs_delete(sqlite3_vfs *vfs, const char *name, int sync_directory)
+        {
+            return guarded(SQLITE_IOERR_DELETE, [vfs, name, sync_directory] { return static_cast<vfs_shim *>(vfs->pAppData)->remove(name, sync_directory); });
+        }
+
+        static int file_close(sqlite3_file *base_file)
+        {
+            auto &f = to_file(base_file);
+            guarded(SQLITE_OK, [&f] { f.shim->closing(f); return SQLITE_OK; });
+
+            return f.real()->pMethods->xClose(f.real());
+        }
+
+        static int file_read(sqlite3_file *base_file, void *data, int amount, sqlite3_int64 offset)
+        {
+            return guarded(SQLITE_IOERR_READ, [&] { return to_file(base_file).shim->read(to_file(base_file), data, amount, offset); });
+        }
+
+        static int file_write(sqlite3_file *base_file, const void *data, int amount, sqlite3_int64 offset)
+        {
+            return guarded(SQLITE_IOERR_WRITE, [&] { return to_file(base_file).shim->write(to_file(base_file), data, amount, offset); });
+        }
+
+        static int file_truncate(sqlite3_file *base_file, sqlite3_int64 size)
+        {
+            return guarded(SQLITE_IOERR_TRUNCATE, [&] { return to_file(base_file).shim->truncate(to_file(base_file), size); });
+        }
+
+        static int file_sync(sqlite3_file *base_file, int flags)
+        {
+            return guarded(SQLITE_IOERR_FSYNC, [&] { return to_file(base_file).shim->sync(to_file(base_file), flags); });
+        }
+
+        static int file_fetch(sqlite3_file *base_file, sqlite3_int64 offset, int amount, void **data)
+        {
+            if (real(base_file)->pMethods->iVersion < 3)
+            {
+                *data = nullptr;
+                return SQLITE_OK;
+            }
+
+            *data = nullptr;
+            return guarded(SQLITE_IOERR_MMAP, [&] { return to_file(base_file).shim->fetch(to_file(base_file), offset, amount, data); });
+        }
+
+        static constexpr sqlite3_io_methods io_methods = {
+            3,
+            &vfs_shim::file_close,
+            &vfs_shim::file_read,
+            &vfs_shim::file_write,
+            &vfs_shim::file_truncate,
+            &vfs_shim::file_sync,
+            [](sqlite3_file *f, sqlite3_int64 *size) { return real(f)->pMethods->xFileSize(real(f), size); },
+            [](sqlite3_file *f, int lock) { return real(f)->pMethods->xLock(real(f), lock); },
+            [](sqlite3_file *f, int lock) { return real(f)->pMethods->xUnlock(real(f), lock); },
+            [](sqlite3_file *f, int *reserved) { return real(f)->pMethods->xCheckReservedLock(real(f), reserved); },
+            [](sqlite3_file *f, int op, void *arg) { return real(f)->pMethods->xFileControl(real(f), op, arg); },
+            [](sqlite3_file *f) { return real(f)->pMethods->xSectorSize(real(f)); },
+            [](sqlite3_file *f) { return real(f)->pMethods->xDeviceCharacteristics(real(f)); },
+            [](sqlite3_file *f, int region, int size, int extend, void volatile **memory)
+            {
+                return real(f)->pMethods->iVersion >= 2 ? real(f)->pMethods->xShmMap(real(f), region, size, extend, memory) : SQLITE_IOERR_SHMMAP;
+            },
+            [](sqlite3_file *f, int offset, int count, int flags)
+            {
+                return real(f)->pMethods->iVersion >= 2 ? real(f)->pMethods->xShmLock(real(f), offset, count, flags) : SQLITE_IOERR_SHMLOCK;
+            },
+            [](sqlite3_file *f)
+            {
+                if (real(f)->pMethods->iVersion >= 2)
+                {
+                    real(f)->pMethods->xShmBarrier(real(f));
+                }
+            },
+            [](sqlite3_file *f, int remove)
+            {
+                return real(f)->pMethods->iVersion >= 2 ? real(f)->pMethods->xShmUnmap(real(f), remove) : SQLITE_OK;
+            },
+            &vfs_shim::file_fetch,
+            [](sqlite3_file *f, sqlite3_int64 offset, void *data)
+            {
+                return real(f)->pMethods->iVersion >= 3 ? real(f)->pMethods->xUnfetch(real(f), offset, data) : SQLITE_OK;
+            },
+        };
+
+        std::string _name;
+        sqlite3_vfs *_base;
+        sqlite3_vfs _vfs = {};
+    };
+}
@@ -0,0 +1,395 @@
+#pragma once
+
+#include "sqlite3_wal_shipper.h"
+
+#include <zlib.h>
+
+#include <exception>
+#include <thread>
+
+namespace sqlite3_wrapper
+{
+    struct archive_segment
+    {
+        uint64_t sequence;
+        // commit time of the last commit in the segment, ns since epoch
+        int64_t committed_at;
+    };
+
+    namespace detail
+    {
+        // Segment file: magic, sequence, commit time, changeset size (host byte order) and the zlib compressed changeset
+        constexpr char segment_magic[8] = {'S', 'Q', 'L', 'W', 'S', 'E', 'G', '1'};
+        constexpr size_t segment_header_size = sizeof(segment_magic) + 3 * sizeof(int64_t);
+
+        inline std::string segment_name(uint64_t sequence)
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "%020llu.segment", static_cast<unsigned long long>(sequence));
+
+            return name;
+        }
+
+        inline bool parse_segment_name(const std::string &name, uint64_t &sequence)
+        {
+            if (name.size() != 28 || name.compare(20, std::string::npos, ".segment") != 0 ||
+                name.find_first_not_of("0123456789") != 20)
+            {
+                return false;
+            }
+
+            sequence = std::stoull(name.substr(0, 20));
+            return true;
+        }
+
+        inline std::vector<uint64_t> list_segments(const std::filesystem::path &directory)
+        {
+            std::vector<uint64_t> sequences;
+            for (const auto &entry : std::filesystem::directory_iterator(directory))
+            {
+                uint64_t sequence;
+                if (parse_segment_name(entry.path().filename().string(), sequence))
+                {
+                    sequences.push_back(sequence);
+                }
+            }
+            std::sort(sequences.begin(), sequences.end());
+
+            return sequences;
+        }
+
+        // Reads the header, and the compressed changeset if data is not null; returns the uncompressed size
+        inline size_t read_segment(const std::filesystem::path &path, archive_segment &segment, std::string *data)
+        {
+            std::ifstream file(path, std::ios::binary);
+            char header[segment_header_size];
+            if (!file.read(header, sizeof(header)) || std::memcmp(header, segment_magic, sizeof(segment_magic)) != 0)
+            {
+                throw std::runtime_error("invalid segment " + path.string());
+            }
+
+            int64_t fields[3];
+            std::memcpy(fields, header + sizeof(segment_magic), sizeof(fields));
+            segment.sequence = static_cast<uint64_t>(fields[0]);
+            segment.committed_at = fields[1];
+
+            if (data)
+            {
+                data->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            }
+
+            return static_cast<size_t>(fields[2]);
+        }
+
+        inline void decompress_segment(const std::filesystem::path &path, std::string &changeset)
+        {
+            archive_segment segment;
+            std::string compressed;
+            auto size = read_segment(path, segment, &compressed);
+
+            changeset.resize(size);
+            uLongf length = static_cast<uLongf>(size);
+            if (uncompress(reinterpret_cast<Bytef *>(&changeset[0]), &length, reinterpret_cast<const Bytef *>(compressed.data()), static_cast<uLong>(compressed.size())) != Z_OK ||
+                length != size)
+            {
+                throw std::runtime_error("corrupted segment " + path.string());
+            }
+        }
+    }
+
+    // Continuous archive of wal_shipper batches as zlib compressed segments next to a copy of base.db,
+    // restore() rebuilds the database as of any archived batch. Segments are never deleted by the archive.
+    // The archive must outlive the shippers it is attached to.
+    class wal_archive
+    {
+    public:
+        explicit wal_archive(const std::string &directory, int compression_level = Z_DEFAULT_COMPRESSION)
+            : _directory(directory)
+            , _compression_level(compression_level)
+        {
+            std::filesystem::create_directories(_directory);
+
+            auto sequences = detail::list_segments(_directory);
+            _sequence = sequences.empty() ? 0 : sequences.back();
+        }
+
+        wal_archive(const wal_archive &) = delete;
+        wal_archive &operator=(const wal_archive &) = delete;
+
+        // Archives batches still in the shipper directory, then every batch the shipper ships. From then on
+        // replica_applier keeps batches in the shipper directory until they are archived, so a batch that
+        // fails to archive is archived with the next one. Throws if batches after the last segment were
+        // already deleted by the applier, the archive can not be continued then.
+        void attach(wal_shipper &shipper)
+        {
+            auto shipper_directory = shipper.directory();
+            if (!std::filesystem::exists(_directory / "base.db"))
+            {
+                std::filesystem::copy_file(shipper_directory / "base.db", _directory / "base.tmp", std::filesystem::copy_options::overwrite_existing);
+                std::filesystem::rename(_directory / "base.tmp", _directory / "base.db");
+            }
+            detail::write_archived(shipper_directory, _sequence);
+            catch_up(shipper_directory);
+            if (shipper.sequence() > _sequence)
+            {
+                std::filesystem::remove(shipper_directory / detail::archived_name);
+                throw std::runtime_error("batch " + std::to_string(_sequence + 1) + " was deleted from " + shipper_directory.string() + " before it was archived");
+            }
+
+            shipper.on_batch([this, shipper_directory](uint64_t sequence, int64_t committed_at, const void *changeset, int size)
+            {
+                if (sequence == _sequence + 1)
+                {
+                    append(sequence, committed_at, changeset, size);
+                    detail::write_archived(shipper_directory, _sequence);
+                }
+                else if (sequence > _sequence)
+                {
+                    catch_up(shipper_directory);
+                    if (sequence > _sequence)
+                    {
+                        throw std::runtime_error("segment " + std::to_string(_sequence + 1) + " is missing in " + _directory.string());
+                    }
+                }
+            });
+        }
+
+        // Appends the segment of a batch, sequences must be consecutive
+        void append(uint64_t sequence, int64_t committed_at, const void *changeset, int size)
+        {
+            if (sequence != _sequence + 1)
+            {
+                throw std::runtime_error("segment " + std::to_string(_sequence + 1) + " is missing in " + _directory.string());
+            }
+
+            auto bound = compressBound(static_cast<uLong>(size));
+            std::string compressed(bound, '\0');
+            if (compress2(reinterpret_cast<Bytef *>(&compressed[0]), &bound, static_cast<const Bytef *>(changeset), static_cast<uLong>(size), _compression_level) != Z_OK)
+            {
+                throw std::runtime_error("failed to compress segment " + std::to_string(sequence));
+            }
+
+            auto path = _directory / detail::segment_name(sequence);
+            auto temporary = path;
+            temporary += ".tmp";
+
+            int64_t header[] = {static_cast<int64_t>(sequence), committed_at, size};
+            {
+                std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+                file.write(detail::segment_magic, sizeof(detail::segment_magic));
+                file.write(reinterpret_cast<const char *>(header), sizeof(header));
+                file.write(compressed.data(), static_cast<std::streamsize>(bound));
+                if (!file.flush())
+                {
+                    throw std::runtime_error("failed to write " + temporary.string());
+                }
+            }
+            std::filesystem::rename(temporary, path);
+            _sequence = sequence;
+        }
+
+        // Sequence of the last archived segment
+        uint64_t sequence() const
+        {
+            return _sequence;
+        }
+
+        std::vector<archive_segment> segments() const
+        {
+            std::vector<archive_segment> segments;
+            for (auto sequence : detail::list_segments(_directory))
+            {
+                archive_segment segment;
+                detail::read_segment(_directory / detail::segment_name(sequence), segment, nullptr);
+                segments.push_back(segment);
+            }
+
+            return segments;
+        }
+
+        // Last segment committed at or before time_ns, 0 restores base.db only
+        uint64_t sequence_at(int64_t time_ns) const
+        {
+            uint64_t sequence = 0;
+            for (const auto &segment : segments())
+            {
+                if (segment.committed_at > time_ns)
+                {
+                    break;
+                }
+                sequence = segment.sequence;
+            }
+
+            return sequence;
+        }
+
+        // Rebuilds the database as of segment sequence into a new file, applying segments in one transaction
+        // while threads decompress the following ones; returns the number of applied segments
+        size_t restore(const std::string &filename, uint64_t sequence, unsigned int threads = std::thread::hardware_concurrency()) const
+        {
+            auto sequences = detail::list_segments(_directory);
+            sequences.erase(std::upper_bound(sequences.begin(), sequences.end(), sequence), sequences.end());
+            for (size_t i = 0; i < sequences.size(); ++i)
+            {
+                if (sequences[i] != i + 1)
+                {
+                    throw std::runtime_error("segment " + std::to_string(i + 1) + " is missing in " + _directory.string());
+                }
+            }
+            if (sequence > sequences.size())
+            {
+                throw std::runtime_error("segment " + std::to_string(sequence) + " is not archived in " + _directory.string());
+            }
+
+            std::filesystem::copy_file(_directory / "base.db", filename);
+            db db(filename);
+
+            restore_state state(sequences.size(), std::max(1u, threads));
+            std::vector<std::thread> workers;
+            for (unsigned int t = 0; t < state.threads; ++t)
+            {
+                workers.emplace_back([this, &state, &sequences] { decompress(state, sequences); });
+            }
+
+            try
+            {
+                db.begin(transaction_type::IMMEDIATE);
+                for (size_t i = 0; i < sequences.size(); ++i)
+                {
+                    std::string changeset;
+                    {
+                        std::unique_lock<std::mutex> lock(state.mutex);
+                        state.condition.wait(lock, [&state, i] { return state.ready[i] || state.error; });
+                        if (state.error)
+                        {
+                            std::rethrow_exception(state.error);
+                        }
+                        changeset.swap(state.changesets[i]);
+                        state.applied = i + 1;
+                    }
+                    state.condition.notify_all();
+
+                    detail::apply_changeset(db, changeset.data(), static_cast<int>(changeset.size()));
+                }
+                db.commit();
+            }
+            catch (...)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(state.mutex);
+                    state.stopping = true;
+                }
+                state.condition.notify_all();
+                for (auto &worker : workers)
+                {
+                    worker.join();
+                }
+                throw;
+            }
+
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+
+            return sequences.size();
+        }
+
+    private:
+        struct restore_state
+        {
+            restore_state(size_t count, unsigned int threads)
+                : changesets(count)
+                , ready(count)
+                , threads(threads)
+                // bounds memory of decompressed segments waiting to be applied
+                , window(threads * 4)
+            {
+            }
+
+            std::mutex mutex;
+            std::condition_variable condition;
+            std::vector<std::string> changesets;
+            std::vector<char> ready;
+            unsigned int threads;
+            size_t window;
+            size_t next = 0;
+            size_t applied = 0;
+            bool stopping = false;
+            std::exception_ptr error;
+        };
+
+        void decompress(restore_state &state, const std::vector<uint64_t> &sequences) const
+        {
+            for (;;)
+            {
+                size_t i;
+                {
+                    std::unique_lock<std::mutex> lock(state.mutex);
+                    state.condition.wait(lock, [&state] { return state.stopping || state.error || state.next >= state.changesets.size() || state.next < state.applied + state.window; });
+                    if (state.stopping || state.error || state.next >= state.changesets.size())
+                    {
+                        return;
+                    }
+                    i = state.next++;
+                }
+
+                std::string changeset;
+                std::exception_ptr error;
+                try
+                {
+                    detail::decompress_segment(_directory / detail::segment_name(sequences[i]), changeset);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(state.mutex);
+                    if (error)
+                    {
+                        state.error = error;
+                    }
+                    else
+                    {
+                        state.changesets[i].swap(changeset);
+                        state.ready[i] = 1;
+                    }
+                }
+                state.condition.notify_all();
+            }
+        }
+
+        // Stops at the first gap, attach() reports one before the handler is installed
+        void catch_up(const std::filesystem::path &shipper_directory)
+        {
+            auto archived = _sequence;
+            for (auto sequence : detail::list_batches(shipper_directory))
+            {
+                if (sequence <= _sequence)
+                {
+                    continue;
+                }
+                if (sequence != _sequence + 1)
+                {
+                    break;
+                }
+
+                std::string data;
+                size_t offset;
+                auto committed_at = detail::read_batch(shipper_directory / detail::batch_name(sequence), data, offset);
+                append(sequence, committed_at, data.data() + offset, static_cast<int>(data.size() - offset));
+            }
+
+            if (_sequence != archived)
+            {
+                detail::write_archived(shipper_directory, _sequence);
+            }
+        }
+
+        std::filesystem::path _directory;
+        int _compression_level;
+        uint64_t _sequence;
+    };
+}
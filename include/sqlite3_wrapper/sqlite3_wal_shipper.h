@@ -0,0 +1,462 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+// sqlite3.h declares the session extension only with these options, they must be defined for the whole project,
+// e.g. by the SQLITE3_WRAPPER_SESSION CMake option, and the SQLite library must be built with them
+#if !defined(SQLITE_ENABLE_SESSION) || !defined(SQLITE_ENABLE_PREUPDATE_HOOK)
+#error "wal_shipper requires SQLITE_ENABLE_SESSION and SQLITE_ENABLE_PREUPDATE_HOOK to be defined by the build"
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+namespace sqlite3_wrapper
+{
+    namespace detail
+    {
+        // Batch file: magic, sequence, commit time (ns since epoch) in host byte order and the changeset
+        constexpr char changeset_magic[8] = {'S', 'Q', 'L', 'C', 'S', 'E', 'T', '1'};
+        constexpr size_t changeset_header_size = sizeof(changeset_magic) + 2 * sizeof(int64_t);
+
+        inline std::string batch_name(uint64_t sequence)
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "%020llu.changeset", static_cast<unsigned long long>(sequence));
+
+            return name;
+        }
+
+        inline bool parse_batch_name(const std::string &name, uint64_t &sequence)
+        {
+            if (name.size() != 30 || name.compare(20, std::string::npos, ".changeset") != 0 ||
+                name.find_first_not_of("0123456789") != 20)
+            {
+                return false;
+            }
+
+            sequence = std::stoull(name.substr(0, 20));
+            return true;
+        }
+
+        // Sorted sequences of the batches in directory
+        inline std::vector<uint64_t> list_batches(const std::filesystem::path &directory)
+        {
+            std::vector<uint64_t> sequences;
+            for (const auto &entry : std::filesystem::directory_iterator(directory))
+            {
+                uint64_t sequence;
+                if (parse_batch_name(entry.path().filename().string(), sequence))
+                {
+                    sequences.push_back(sequence);
+                }
+            }
+            std::sort(sequences.begin(), sequences.end());
+
+            return sequences;
+        }
+
+        // Sequence up to which a wal_archive attached to the directory has archived batches, written by the
+        // archive and read by replica_applier, which keeps the batches after it
+        constexpr char archived_name[] = "archived";
+
+        inline bool read_archived(const std::filesystem::path &directory, uint64_t &sequence)
+        {
+            std::ifstream file(directory / archived_name);
+            unsigned long long value;
+            if (!(file >> value))
+            {
+                return false;
+            }
+
+            sequence = static_cast<uint64_t>(value);
+            return true;
+        }
+
+        inline void write_archived(const std::filesystem::path &directory, uint64_t sequence)
+        {
+            auto path = directory / archived_name;
+            auto temporary = path;
+            temporary += ".tmp";
+            {
+                std::ofstream file(temporary, std::ios::trunc);
+                file << sequence;
+                if (!file.flush())
+                {
+                    throw std::runtime_error("failed to write " + temporary.string());
+                }
+            }
+            std::filesystem::rename(temporary, path);
+        }
+
+        inline int64_t system_time_ns()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        // The target converges to the source: conflicting rows are overwritten, missing ones skipped
+        inline int changeset_conflict(void *, int type, sqlite3_changeset_iter *)
+        {
+            switch (type)
+            {
+            case SQLITE_CHANGESET_DATA:
+            case SQLITE_CHANGESET_CONFLICT:
+                return SQLITE_CHANGESET_REPLACE;
+            case SQLITE_CHANGESET_NOTFOUND:
+                return SQLITE_CHANGESET_OMIT;
+            default:
+                return SQLITE_CHANGESET_ABORT;
+            }
+        }
+
+        inline void apply_changeset(db &db, const void *changeset, int size)
+        {
+            auto res = sqlite3changeset_apply(db.native_handle(), size, const_cast<void *>(changeset), nullptr, &changeset_conflict, nullptr);
+            if (res != SQLITE_OK)
+            {
+                throw exception(db.native_handle());
+            }
+        }
+
+        // Reads a batch file, returns its commit time and sets offset to the start of the changeset
+        inline int64_t read_batch(const std::filesystem::path &path, std::string &data, size_t &offset)
+        {
+            std::ifstream file(path, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            if (data.size() < changeset_header_size || data.compare(0, sizeof(changeset_magic), changeset_magic, sizeof(changeset_magic)) != 0)
+            {
+                throw std::runtime_error("invalid batch " + path.string());
+            }
+
+            int64_t committed_at;
+            std::memcpy(&committed_at, data.data() + sizeof(changeset_magic) + sizeof(int64_t), sizeof(committed_at));
+            offset = changeset_header_size;
+
+            return committed_at;
+        }
+    }
+
+    // Ships changes committed through the connection to a directory as numbered session changeset batches,
+    // which replica_applier applies to a standby database. The directory is seeded with base.db (VACUUM INTO)
+    // when it has none. Changes made while no shipper is attached, by other connections or to tables without
+    // a PRIMARY KEY, and schema changes are not shipped. Requires WAL mode, batches are not fsynced.
+    class wal_shipper
+    {
+    public:
+        // Called after a batch is shipped with its sequence, commit time (ns since epoch) and changeset
+        using batch_handler = std::function<void(uint64_t, int64_t, const void *, int)>;
+
+        // batch_interval 0 ships every commit, otherwise commits are merged into batches shipped at most
+        // once per interval; ship() writes the pending batch at any time, e.g. when idle. A batch that
+        // fails to ship after a commit stays in the session for the next attempt and is reported by last_error().
+        wal_shipper(db &db, const std::string &directory, std::chrono::milliseconds batch_interval = std::chrono::milliseconds(0))
+            : _db(db)
+            , _directory(directory)
+            , _batch_interval(batch_interval)
+        {
+            std::filesystem::create_directories(_directory);
+
+            auto sequences = detail::list_batches(_directory);
+            _sequence = sequences.empty() ? 0 : sequences.back();
+
+            start_session();
+            if (!std::filesystem::exists(_directory / "base.db"))
+            {
+                _db.execute("VACUUM INTO ?", (_directory / "base.tmp").string());
+                std::filesystem::rename(_directory / "base.tmp", _directory / "base.db");
+            }
+
+            _subscription = _db.commits().subscribe([this](const commit_event &event)
+            {
+                if (event.source == commit_source::LOCAL && std::chrono::steady_clock::now() - _last_ship >= _batch_interval)
+                {
+                    // called from the WAL hook, exceptions must not unwind through SQLite
+                    try
+                    {
+                        ship_batch();
+                    }
+                    catch (...)
+                    {
+                        _last_error = std::current_exception();
+                    }
+                }
+            });
+        }
+
+        wal_shipper(const wal_shipper &) = delete;
+        wal_shipper &operator=(const wal_shipper &) = delete;
+
+        ~wal_shipper()
+        {
+            _db.commits().unsubscribe(_subscription);
+            try
+            {
+                if (_db.autocommit())
+                {
+                    ship_batch();
+                }
+            }
+            catch (...)
+            {
+            }
+            sqlite3session_delete(_session);
+        }
+
+        // Writes changes committed since the last batch, returns false if there were none. Throws inside
+        // a transaction, whose uncommitted changes are in the session too.
+        bool ship()
+        {
+            if (!_db.autocommit())
+            {
+                throw std::logic_error("wal_shipper::ship() called inside a transaction");
+            }
+
+            return ship_batch();
+        }
+
+        // Failure of the last batch shipped after a commit, cleared once a batch is shipped
+        std::exception_ptr last_error() const
+        {
+            return _last_error;
+        }
+
+        void on_batch(batch_handler handler)
+        {
+            _batch_handlers.push_back(std::move(handler));
+        }
+
+        // Sequence of the last shipped batch
+        uint64_t sequence() const
+        {
+            return _sequence;
+        }
+
+        const std::filesystem::path &directory() const
+        {
+            return _directory;
+        }
+
+    private:
+        bool ship_batch()
+        {
+            _last_ship = std::chrono::steady_clock::now();
+            if (!_session)
+            {
+                start_session();
+            }
+            if (sqlite3session_isempty(_session))
+            {
+                return false;
+            }
+
+            int size = 0;
+            void *data = nullptr;
+            auto res = sqlite3session_changeset(_session, &size, &data);
+            if (res != SQLITE_OK)
+            {
+                throw exception(_db.native_handle());
+            }
+            std::unique_ptr<void, decltype(&sqlite3_free)> changeset(data, &sqlite3_free);
+
+            auto committed_at = detail::system_time_ns();
+            write_batch(_sequence + 1, committed_at, changeset.get(), size);
+            ++_sequence;
+
+            // a new session starts the next batch, sessions can not be cleared
+            sqlite3session_delete(_session);
+            _session = nullptr;
+            _last_error = nullptr;
+            start_session();
+
+            for (const auto &handler : _batch_handlers)
+            {
+                handler(_sequence, committed_at, changeset.get(), size);
+            }
+
+            return true;
+        }
+
+        void start_session()
+        {
+            if (sqlite3session_create(_db.native_handle(), "main", &_session) != SQLITE_OK ||
+                sqlite3session_attach(_session, nullptr) != SQLITE_OK)
+            {
+                exception e(_db.native_handle());
+                sqlite3session_delete(_session);
+                _session = nullptr;
+                throw e;
+            }
+        }
+
+        // Written to a temporary file and renamed, so the applier never sees partial batches
+        void write_batch(uint64_t sequence, int64_t committed_at, const void *changeset, int size)
+        {
+            auto path = _directory / detail::batch_name(sequence);
+            auto temporary = path;
+            temporary += ".tmp";
+
+            int64_t header[] = {static_cast<int64_t>(sequence), committed_at};
+            {
+                std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+                file.write(detail::changeset_magic, sizeof(detail::changeset_magic));
+                file.write(reinterpret_cast<const char *>(header), sizeof(header));
+                file.write(static_cast<const char *>(changeset), size);
+                if (!file.flush())
+                {
+                    throw std::runtime_error("failed to write " + temporary.string());
+                }
+            }
+            std::filesystem::rename(temporary, path);
+        }
+
+        db &_db;
+        std::filesystem::path _directory;
+        std::chrono::milliseconds _batch_interval;
+        std::chrono::steady_clock::time_point _last_ship;
+        sqlite3_session *_session = nullptr;
+        uint64_t _sequence = 0;
+        size_t _subscription = 0;
+        std::vector<batch_handler> _batch_handlers;
+        std::exception_ptr _last_error;
+    };
+
+    struct replication_lag
+    {
+        uint64_t applied_sequence = 0;
+        // batches found but not applied by the last apply()
+        uint64_t pending_batches = 0;
+        // from commit on the primary to apply on the standby, of the last applied batch
+        std::chrono::nanoseconds delay{0};
+        std::chrono::nanoseconds max_delay{0};
+    };
+
+    // Applies batches of a wal_shipper directory to a standby database in sequence order, each in one transaction
+    // together with the applied sequence kept in the replica_state table. An empty standby is first restored
+    // from base.db. Applied batches except the last one are deleted, so the shipper never reuses sequences,
+    // and batches a wal_archive attached to the directory has not archived yet are kept until it has.
+    class replica_applier
+    {
+    public:
+        replica_applier(db &standby, const std::string &directory)
+            : _db(standby)
+            , _directory(directory)
+            , _lag(open_state(standby, _directory))
+            , _state_statement(_db.prepare("UPDATE replica_state SET sequence = ?, committed_at = ?, applied_at = ?"))
+        {
+        }
+
+        // Applies all complete batches after the applied sequence, returns how many were applied
+        size_t apply()
+        {
+            auto sequences = detail::list_batches(_directory);
+            auto next = std::upper_bound(sequences.begin(), sequences.end(), _lag.applied_sequence);
+            _lag.pending_batches = static_cast<uint64_t>(sequences.end() - next);
+
+            size_t applied = 0;
+            for (; next != sequences.end(); ++next)
+            {
+                if (*next != _lag.applied_sequence + 1)
+                {
+                    throw std::runtime_error("batch " + std::to_string(_lag.applied_sequence + 1) + " is missing in " + _directory.string());
+                }
+
+                apply_batch(*next);
+                --_lag.pending_batches;
+                ++applied;
+            }
+
+            // the last applied batch is kept for the shipper to continue its numbering after restart
+            auto archived = std::numeric_limits<uint64_t>::max();
+            detail::read_archived(_directory, archived);
+            for (auto sequence : sequences)
+            {
+                if (sequence >= _lag.applied_sequence || sequence > archived)
+                {
+                    break;
+                }
+                std::filesystem::remove(_directory / detail::batch_name(sequence));
+            }
+
+            return applied;
+        }
+
+        const replication_lag &lag() const
+        {
+            return _lag;
+        }
+
+    private:
+        static replication_lag open_state(db &standby, const std::filesystem::path &directory)
+        {
+            int64_t tables = 0;
+            standby.execute("SELECT count(*) FROM sqlite_master WHERE name = 'replica_state'").fetch(tables);
+            if (!tables)
+            {
+                restore_base(standby, directory);
+                standby.execute("CREATE TABLE replica_state(id INTEGER PRIMARY KEY CHECK (id = 0), sequence INTEGER NOT NULL, committed_at INTEGER NOT NULL, applied_at INTEGER NOT NULL)");
+                standby.execute("INSERT INTO replica_state VALUES (0, 0, 0, 0)");
+            }
+
+            int64_t sequence = 0;
+            standby.execute("SELECT sequence FROM replica_state").fetch(sequence);
+
+            replication_lag lag;
+            lag.applied_sequence = static_cast<uint64_t>(sequence);
+            return lag;
+        }
+
+        static void restore_base(db &standby, const std::filesystem::path &directory)
+        {
+            db base((directory / "base.db").string(), SQLITE_OPEN_READONLY);
+
+            auto backup = sqlite3_backup_init(standby.native_handle(), "main", base.native_handle(), "main");
+            if (!backup)
+            {
+                throw exception(standby.native_handle());
+            }
+            sqlite3_backup_step(backup, -1);
+            if (sqlite3_backup_finish(backup) != SQLITE_OK)
+            {
+                throw exception(standby.native_handle());
+            }
+        }
+
+        void apply_batch(uint64_t sequence)
+        {
+            std::string data;
+            size_t offset;
+            auto committed_at = detail::read_batch(_directory / detail::batch_name(sequence), data, offset);
+
+            _db.begin(transaction_type::IMMEDIATE);
+            try
+            {
+                detail::apply_changeset(_db, data.data() + offset, static_cast<int>(data.size() - offset));
+
+                auto applied_at = detail::system_time_ns();
+                _state_statement.execute(static_cast<int64_t>(sequence), committed_at, applied_at);
+                _db.commit();
+
+                _lag.applied_sequence = sequence;
+                _lag.delay = std::chrono::nanoseconds(applied_at - committed_at);
+                _lag.max_delay = std::max(_lag.max_delay, _lag.delay);
+            }
+            catch (...)
+            {
+                if (!_db.autocommit())
+                {
+                    _db.rollback();
+                }
+                throw;
+            }
+        }
+
+        db &_db;
+        std::filesystem::path _directory;
+        replication_lag _lag;
+        statement _state_statement;
+    };
+}
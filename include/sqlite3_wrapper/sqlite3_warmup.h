@@ -0,0 +1,311 @@
+#pragma once
+
+#include "sqlite3_vfs_shim.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sqlite3_wrapper
+{
+    // VFS shim counting page reads of main database files opened through it, e.g. during a period of
+    // representative traffic, to save the hot pages as the warm-up profile of the database
+    class page_access_recorder : public vfs_shim
+    {
+    public:
+        explicit page_access_recorder(const std::string &name = "page_access_recorder", const char *base_vfs = nullptr)
+            : vfs_shim(name, base_vfs)
+        {
+        }
+
+        // Pages of the database read at least once, most read first
+        std::vector<uint32_t> hot_pages(const std::string &filename, size_t limit = SIZE_MAX) const
+        {
+            std::vector<std::pair<uint64_t, uint32_t>> counts;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto it = _databases.find(key(filename));
+                if (it == _databases.end())
+                {
+                    return {};
+                }
+
+                std::lock_guard<std::mutex> database_lock(it->second->mutex);
+                for (const auto &count : it->second->counts)
+                {
+                    counts.emplace_back(count.second, count.first);
+                }
+            }
+
+            std::sort(counts.begin(), counts.end(), [](const auto &a, const auto &b) { return a.first > b.first || (a.first == b.first && a.second < b.second); });
+            counts.resize(std::min(limit, counts.size()));
+
+            std::vector<uint32_t> pages;
+            pages.reserve(counts.size());
+            for (const auto &count : counts)
+            {
+                pages.push_back(count.second);
+            }
+
+            return pages;
+        }
+
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto &database : _databases)
+            {
+                std::lock_guard<std::mutex> database_lock(database.second->mutex);
+                database.second->counts.clear();
+            }
+        }
+
+    protected:
+        void opened(vfs_file &file, const char *name) override
+        {
+            if ((file.flags & SQLITE_OPEN_MAIN_DB) && name)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto &database = _databases[key(name)];
+                if (!database)
+                {
+                    database.reset(new struct database());
+                }
+                file.state = database.get();
+            }
+        }
+
+        int read(vfs_file &file, void *data, int amount, sqlite3_int64 offset) override
+        {
+            record(file, amount, offset);
+            return vfs_shim::read(file, data, amount, offset);
+        }
+
+        int fetch(vfs_file &file, sqlite3_int64 offset, int amount, void **data) override
+        {
+            record(file, amount, offset);
+            return vfs_shim::fetch(file, offset, amount, data);
+        }
+
+    private:
+        struct database
+        {
+            std::mutex mutex;
+            std::unordered_map<uint32_t, uint64_t> counts;
+        };
+
+        static std::string key(const std::string &filename)
+        {
+            return std::filesystem::weakly_canonical(filename).string();
+        }
+
+        // Page reads have the page size, other reads (e.g. the 100 byte header) are not pages
+        static void record(vfs_file &file, int amount, sqlite3_int64 offset)
+        {
+            auto database = static_cast<struct database *>(file.state);
+            if (!database || amount < 512 || (amount & (amount - 1)) != 0)
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(database->mutex);
+            ++database->counts[static_cast<uint32_t>(offset / amount + 1)];
+        }
+
+        mutable std::mutex _mutex;
+        std::map<std::string, std::unique_ptr<database>> _databases;
+    };
+
+    // Warm-up profile file: one page number per line
+    inline void save_warmup_profile(const std::string &filename, const std::vector<uint32_t> &pages)
+    {
+        std::ofstream file(filename, std::ios::trunc);
+        for (auto page : pages)
+        {
+            file << page << '\n';
+        }
+
+        if (!file)
+        {
+            throw std::runtime_error("failed to write warm-up profile to " + filename);
+        }
+    }
+
+    // Returns no pages if the profile does not exist
+    inline std::vector<uint32_t> load_warmup_profile(const std::string &filename)
+    {
+        std::ifstream file(filename);
+        std::vector<uint32_t> pages;
+        uint32_t page;
+        while (file >> page)
+        {
+            pages.push_back(page);
+        }
+
+        return pages;
+    }
+
+    // Root and interior b-tree pages of the schema (dbstat virtual table), the pages every lookup goes through;
+    // empty if SQLite is built without SQLITE_ENABLE_DBSTAT_VTAB
+    inline std::vector<uint32_t> interior_pages(db &db, const std::string &schema = "main")
+    {
+        std::string quoted_schema = "\"";
+        for (auto c : schema)
+        {
+            quoted_schema += c;
+            if (c == '"')
+            {
+                quoted_schema += c;
+            }
+        }
+        quoted_schema += '"';
+
+        std::vector<uint32_t> pages;
+        try
+        {
+            auto statement = db.prepare("SELECT pageno FROM dbstat(?) WHERE pagetype = 'internal' UNION SELECT rootpage FROM " + quoted_schema + ".sqlite_master WHERE rootpage > 0");
+            statement.execute(schema);
+
+            int64_t page;
+            while (statement.fetch(page))
+            {
+                pages.push_back(static_cast<uint32_t>(page));
+            }
+        }
+        catch (const exception &)
+        {
+            if (std::strcmp(sqlite3_errmsg(db.native_handle()), "no such table: dbstat") != 0)
+            {
+                throw;
+            }
+        }
+
+        return pages;
+    }
+
+    // Loads pages of a database file into the OS page cache on a background thread: pages are coalesced
+    // into ranges, announced with posix_fadvise(POSIX_FADV_WILLNEED) and then read sequentially
+    class page_prefetcher
+    {
+    public:
+        // Ranges are merged across gaps of up to max_gap pages, reading a few extra pages beats seeking
+        page_prefetcher(const std::string &filename, std::vector<uint32_t> pages, uint32_t max_gap = 8)
+            : _thread(&page_prefetcher::run, this, filename, std::move(pages), max_gap)
+        {
+        }
+
+        // Prefetches the main database file of the connection
+        page_prefetcher(db &db, std::vector<uint32_t> pages, uint32_t max_gap = 8)
+            : page_prefetcher(sqlite3_db_filename(db.native_handle(), "main"), std::move(pages), max_gap)
+        {
+        }
+
+        page_prefetcher(const page_prefetcher &) = delete;
+        page_prefetcher &operator=(const page_prefetcher &) = delete;
+
+        // Stops prefetching that is still running
+        ~page_prefetcher()
+        {
+            _stopping = true;
+            wait();
+        }
+
+        void wait()
+        {
+            if (_thread.joinable())
+            {
+                _thread.join();
+            }
+        }
+
+        bool done() const
+        {
+            return _done;
+        }
+
+        uint64_t bytes_read() const
+        {
+            return _bytes_read;
+        }
+
+    private:
+        void run(const std::string &filename, std::vector<uint32_t> pages, uint32_t max_gap)
+        {
+            auto fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd >= 0)
+            {
+                prefetch(fd, pages, max_gap);
+                ::close(fd);
+            }
+            _done = true;
+        }
+
+        void prefetch(int fd, std::vector<uint32_t> &pages, uint32_t max_gap)
+        {
+            // page size is at offset 16 of the header, big endian, 1 means 65536
+            unsigned char header[100];
+            if (::pread(fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+            {
+                return;
+            }
+            off_t page_size = header[16] << 8 | header[17];
+            if (page_size == 1)
+            {
+                page_size = 65536;
+            }
+
+            std::sort(pages.begin(), pages.end());
+            pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+            std::vector<std::pair<off_t, off_t>> ranges;
+            for (auto page : pages)
+            {
+                if (page == 0)
+                {
+                    continue;
+                }
+
+                auto offset = (static_cast<off_t>(page) - 1) * page_size;
+                if (!ranges.empty() && offset <= ranges.back().second + static_cast<off_t>(max_gap) * page_size)
+                {
+                    ranges.back().second = offset + page_size;
+                }
+                else
+                {
+                    ranges.emplace_back(offset, offset + page_size);
+                }
+            }
+
+            for (const auto &range : ranges)
+            {
+                ::posix_fadvise(fd, range.first, range.second - range.first, POSIX_FADV_WILLNEED);
+            }
+
+            std::vector<char> buffer(1 << 20);
+            for (const auto &range : ranges)
+            {
+                for (auto offset = range.first; offset < range.second && !_stopping;)
+                {
+                    auto size = std::min(static_cast<off_t>(buffer.size()), range.second - offset);
+                    auto read = ::pread(fd, buffer.data(), static_cast<size_t>(size), offset);
+                    if (read <= 0)
+                    {
+                        break;
+                    }
+                    offset += read;
+                    _bytes_read += static_cast<uint64_t>(read);
+                }
+            }
+        }
+
+        std::atomic<bool> _stopping{false};
+        std::atomic<bool> _done{false};
+        std::atomic<uint64_t> _bytes_read{0};
+        std::thread _thread;
+    };
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <fstream>
+#include <map>
+
+namespace sqlite3_wrapper
+{
+    struct workload_entry
+    {
+        std::string sql;
+        uint64_t calls = 0;
+        // SQLite measures profile time with millisecond granularity
+        uint64_t time_ns = 0;
+    };
+
+    // Records distinct SQL executed by attached connections (sqlite3_trace_v2 profile events)
+    // with call counts and time, e.g. as input for the index_advisor tool
+    class workload_recorder
+    {
+    public:
+        workload_recorder() = default;
+
+        workload_recorder(const workload_recorder &) = delete;
+        workload_recorder &operator=(const workload_recorder &) = delete;
+
+        // Replaces the trace callback of the connection
+        void attach(db &db)
+        {
+            sqlite3_trace_v2(db.native_handle(), SQLITE_TRACE_PROFILE, &workload_recorder::trace, this);
+        }
+
+        void detach(db &db)
+        {
+            sqlite3_trace_v2(db.native_handle(), 0, nullptr, nullptr);
+        }
+
+        std::vector<workload_entry> entries() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            std::vector<workload_entry> entries;
+            entries.reserve(_entries.size());
+            for (const auto &entry : _entries)
+            {
+                entries.push_back(entry.second);
+            }
+
+            return entries;
+        }
+
+        // File format: "<calls> <time_ns> <sql size>\n<sql>\n" per entry
+        void save(const std::string &filename) const
+        {
+            std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+            for (const auto &entry : entries())
+            {
+                file << entry.calls << ' ' << entry.time_ns << ' ' << entry.sql.size() << '\n' << entry.sql << '\n';
+            }
+
+            if (!file)
+            {
+                throw std::runtime_error("failed to write workload to " + filename);
+            }
+        }
+
+        static std::vector<workload_entry> load(const std::string &filename)
+        {
+            std::ifstream file(filename, std::ios::binary);
+            if (!file)
+            {
+                throw std::runtime_error("failed to open workload " + filename);
+            }
+
+            std::vector<workload_entry> entries;
+            workload_entry entry;
+            size_t size;
+            while (file >> entry.calls >> entry.time_ns >> size && file.get() == '\n')
+            {
+                entry.sql.resize(size);
+                if (!file.read(&entry.sql[0], static_cast<std::streamsize>(size)))
+                {
+                    break;
+                }
+                file.get();
+                entries.push_back(entry);
+            }
+
+            return entries;
+        }
+
+    private:
+        static int trace(unsigned int, void *recorder, void *statement, void *time_ns)
+        {
+            auto sql = sqlite3_sql(static_cast<sqlite3_stmt *>(statement));
+            if (sql)
+            {
+                static_cast<workload_recorder *>(recorder)->record(sql, *static_cast<sqlite3_int64 *>(time_ns));
+            }
+
+            return 0;
+        }
+
+        void record(const char *sql, sqlite3_int64 time_ns)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            auto &entry = _entries[sql];
+            if (entry.calls == 0)
+            {
+                entry.sql = sql;
+            }
+            ++entry.calls;
+            entry.time_ns += static_cast<uint64_t>(time_ns);
+        }
+
+        mutable std::mutex _mutex;
+        std::map<std::string, workload_entry> _entries;
+    };
+}
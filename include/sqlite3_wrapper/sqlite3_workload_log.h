@@ -0,0 +1,687 @@
+#pragma once
+
+#include "sqlite3_wrapper.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <list>
+
+namespace sqlite3_wrapper
+{
+    struct workload_value
+    {
+        int type = SQLITE_NULL;
+        int64_t integer = 0;
+        double real = 0;
+        // text or blob
+        std::string bytes;
+    };
+
+    struct workload_execution
+    {
+        uint32_t connection = 0;
+        uint32_t statement = 0;
+        // start relative to the start of recording
+        uint64_t start_us = 0;
+        uint64_t duration_ns = 0;
+        // values of parameters 1..N
+        std::vector<workload_value> parameters;
+    };
+
+    namespace detail
+    {
+        inline void write_varint(std::string &out, uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                out += static_cast<char>(value | 0x80);
+                value >>= 7;
+            }
+            out += static_cast<char>(value);
+        }
+
+        inline bool read_varint(std::istream &in, uint64_t &value)
+        {
+            value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                auto c = in.get();
+                if (c == std::char_traits<char>::eof())
+                {
+                    return false;
+                }
+
+                value |= static_cast<uint64_t>(c & 0x7f) << shift;
+                if ((c & 0x80) == 0)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        inline bool is_identifier_char(char c)
+        {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || (c & 0x80);
+        }
+
+        inline int hex_digit(char c)
+        {
+            if (c >= '0' && c <= '9')
+            {
+                return c - '0';
+            }
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+            return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        }
+
+        // Reads a literal written by sqlite3_expanded_sql at position, returns position after it or
+        // std::string::npos if it is malformed. Called from the trace callback, so it must not throw.
+        inline size_t parse_expanded_literal(const char *sql, size_t position, workload_value &value)
+        {
+            auto p = sql + position;
+            if (std::strncmp(p, "NULL", 4) == 0)
+            {
+                value.type = SQLITE_NULL;
+                return position + 4;
+            }
+
+            if (*p == '\'')
+            {
+                value.type = SQLITE_TEXT;
+                value.bytes.clear();
+                size_t i = 1;
+                for (; p[i]; ++i)
+                {
+                    if (p[i] == '\'')
+                    {
+                        if (p[i + 1] != '\'')
+                        {
+                            return position + i + 1;
+                        }
+                        ++i;
+                    }
+                    value.bytes += p[i];
+                }
+
+                return std::string::npos;
+            }
+
+            if (std::strncmp(p, "x'", 2) == 0)
+            {
+                value.type = SQLITE_BLOB;
+                value.bytes.clear();
+                size_t i = 2;
+                for (; p[i] != '\''; i += 2)
+                {
+                    auto high = hex_digit(p[i]);
+                    auto low = high < 0 ? -1 : hex_digit(p[i + 1]);
+                    if (low < 0)
+                    {
+                        return std::string::npos;
+                    }
+                    value.bytes += static_cast<char>(high * 16 + low);
+                }
+
+                return position + i + 1;
+            }
+
+            char *end;
+            errno = 0;
+            if (std::strncmp(p, "zeroblob(", 9) == 0)
+            {
+                auto size = std::strtoll(p + 9, &end, 10);
+                if (end == p + 9 || *end != ')' || errno == ERANGE || size < 0)
+                {
+                    return std::string::npos;
+                }
+                value.type = SQLITE_BLOB;
+                value.bytes.assign(static_cast<size_t>(size), '\0');
+
+                return position + static_cast<size_t>(end - p) + 1;
+            }
+
+            size_t i = 0;
+            bool real = false;
+            while (p[i] == '-' || p[i] == '+' || p[i] == '.' || std::isalnum(static_cast<unsigned char>(p[i])))
+            {
+                real = real || (!std::isdigit(static_cast<unsigned char>(p[i])) && p[i] != '-');
+                ++i;
+            }
+
+            std::string literal(p, i);
+            if (real && literal.find("Inf") != std::string::npos)
+            {
+                value.type = SQLITE_FLOAT;
+                value.real = literal[0] == '-' ? -INFINITY : INFINITY;
+            }
+            else if (real)
+            {
+                value.type = SQLITE_FLOAT;
+                value.real = std::strtod(literal.c_str(), &end);
+            }
+            else
+            {
+                value.type = SQLITE_INTEGER;
+                value.integer = std::strtoll(literal.c_str(), &end, 10);
+            }
+
+            if (literal.empty() || end != literal.c_str() + literal.size() || errno == ERANGE)
+            {
+                return std::string::npos;
+            }
+
+            return position + i;
+        }
+
+        // Recovers bound parameters by walking the statement SQL and its sqlite3_expanded_sql in step,
+        // they only differ where a parameter was replaced by its literal. Returns false if the expanded SQL
+        // could not be parsed.
+        inline bool parse_parameters(sqlite3_stmt *statement, const char *sql, const char *expanded, std::vector<workload_value> &parameters)
+        {
+            parameters.assign(static_cast<size_t>(sqlite3_bind_parameter_count(statement)), workload_value());
+
+            int last_index = 0;
+            size_t i = 0;
+            size_t j = 0;
+            while (sql[i] && expanded[j])
+            {
+                if (sql[i] == expanded[j] || !std::strchr("?:@$", sql[i]))
+                {
+                    ++i;
+                    ++j;
+                    continue;
+                }
+
+                auto start = i++;
+                while (is_identifier_char(sql[i]))
+                {
+                    ++i;
+                }
+
+                int index;
+                if (sql[start] == '?' && i == start + 1)
+                {
+                    index = last_index + 1;
+                }
+                else
+                {
+                    index = sqlite3_bind_parameter_index(statement, std::string(sql + start, i - start).c_str());
+                }
+                last_index = std::max(last_index, index);
+
+                workload_value value;
+                j = parse_expanded_literal(expanded, j, value);
+                if (j == std::string::npos)
+                {
+                    return false;
+                }
+
+                if (index > 0 && index <= static_cast<int>(parameters.size()))
+                {
+                    parameters[static_cast<size_t>(index - 1)] = std::move(value);
+                }
+            }
+
+            return true;
+        }
+
+        // Values bound through statement on connections attached to a workload_log, kept per statement until its
+        // execution is recorded. sqlite3_expanded_sql renders REALs with 15 significant digits and cuts TEXT at the
+        // first NUL, the bound values replace the literals recovered from it where they agree.
+        class workload_bindings
+        {
+        public:
+            static void attach(sqlite3 *db)
+            {
+                auto &self = instance();
+                std::lock_guard<std::mutex> lock(self._mutex);
+                ++self._connections[db];
+                current_bind_hook() = &workload_bindings::hook;
+            }
+
+            static void detach(sqlite3 *db)
+            {
+                auto &self = instance();
+                std::lock_guard<std::mutex> lock(self._mutex);
+                auto connection = self._connections.find(db);
+                if (connection == self._connections.end() || --connection->second > 0)
+                {
+                    return;
+                }
+                self._connections.erase(connection);
+
+                for (auto it = self._values.begin(); it != self._values.end();)
+                {
+                    it = it->second.db == db ? self._values.erase(it) : std::next(it);
+                }
+                if (self._connections.empty())
+                {
+                    current_bind_hook() = nullptr;
+                }
+            }
+
+            // Replaces parameters by the bound values they agree with, a statement finalized without being
+            // executed may have left values for another statement at the same address
+            static void apply(sqlite3_stmt *statement, std::vector<workload_value> &parameters)
+            {
+                auto &self = instance();
+                std::lock_guard<std::mutex> lock(self._mutex);
+                auto it = self._values.find(statement);
+                if (it == self._values.end())
+                {
+                    return;
+                }
+
+                auto &values = it->second.values;
+                for (size_t i = 0; i < values.size() && i < parameters.size(); ++i)
+                {
+                    if (agree(parameters[i], values[i]))
+                    {
+                        parameters[i] = std::move(values[i]);
+                    }
+                }
+                self._values.erase(it);
+            }
+
+        private:
+            struct bound
+            {
+                sqlite3 *db = nullptr;
+                std::vector<workload_value> values;
+            };
+
+            static workload_bindings &instance()
+            {
+                static workload_bindings instance;
+                return instance;
+            }
+
+            static void hook(sqlite3_stmt *statement, int index, const bound_value &value)
+            {
+                auto &self = instance();
+                std::lock_guard<std::mutex> lock(self._mutex);
+                auto db = sqlite3_db_handle(statement);
+                if (index < 1 || self._connections.find(db) == self._connections.end())
+                {
+                    return;
+                }
+
+                // values of other types keep their literal
+                workload_value unknown;
+                unknown.type = 0;
+
+                // recording must not fail the binding, the literal is kept instead
+                try
+                {
+                    auto &bound = self._values[statement];
+                    bound.db = db;
+                    if (bound.values.size() < static_cast<size_t>(index))
+                    {
+                        bound.values.resize(static_cast<size_t>(index), unknown);
+                    }
+
+                    auto &exact = bound.values[static_cast<size_t>(index - 1)];
+                    exact.type = value.type;
+                    exact.integer = value.integer;
+                    exact.real = value.real;
+                    exact.bytes.assign(value.data ? value.data : "", value.size);
+                }
+                catch (...)
+                {
+                }
+            }
+
+            static bool agree(const workload_value &literal, const workload_value &exact)
+            {
+                if (literal.type != exact.type)
+                {
+                    return false;
+                }
+
+                switch (exact.type)
+                {
+                case SQLITE_NULL:
+                    return true;
+                case SQLITE_INTEGER:
+                    return literal.integer == exact.integer;
+                case SQLITE_FLOAT:
+                {
+                    if (!std::isfinite(exact.real))
+                    {
+                        return literal.real == exact.real;
+                    }
+
+                    char rendered[32];
+                    std::snprintf(rendered, sizeof(rendered), "%.15g", exact.real);
+                    return std::strtod(rendered, nullptr) == literal.real;
+                }
+                case SQLITE_TEXT:
+                    return literal.bytes.compare(0, std::string::npos, exact.bytes.c_str()) == 0;
+                default:
+                    return false;
+                }
+            }
+
+            std::mutex _mutex;
+            std::unordered_map<sqlite3 *, int> _connections;
+            std::unordered_map<sqlite3_stmt *, bound> _values;
+        };
+    }
+
+    // Records every statement execution of attached connections with its bound parameters and timing
+    // into a compact binary log for the workload_replay tool. Uses the trace callback of the connection.
+    class workload_log
+    {
+    public:
+        explicit workload_log(const std::string &filename)
+            : _file(filename, std::ios::binary | std::ios::trunc)
+            , _start(std::chrono::steady_clock::now())
+        {
+            if (!_file)
+            {
+                throw std::runtime_error("failed to create workload log " + filename);
+            }
+            _file.write(magic, sizeof(magic));
+        }
+
+        workload_log(const workload_log &) = delete;
+        workload_log &operator=(const workload_log &) = delete;
+
+        ~workload_log()
+        {
+            flush();
+            for (auto &connection : _connections)
+            {
+                if (connection.handle)
+                {
+                    detail::workload_bindings::detach(connection.handle);
+                }
+            }
+        }
+
+        void attach(db &db)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _connections.emplace_back(this, static_cast<uint32_t>(_connections.size()), db.native_handle());
+            detail::workload_bindings::attach(db.native_handle());
+            sqlite3_trace_v2(db.native_handle(), SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE, &workload_log::trace, &_connections.back());
+        }
+
+        // Must be called before the log is destroyed if the connection outlives it
+        void detach(db &db)
+        {
+            sqlite3_trace_v2(db.native_handle(), 0, nullptr, nullptr);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto &connection : _connections)
+            {
+                if (connection.handle == db.native_handle())
+                {
+                    detail::workload_bindings::detach(connection.handle);
+                    connection.handle = nullptr;
+                }
+            }
+        }
+
+        void flush()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _file.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+            _file.flush();
+            _buffer.clear();
+        }
+
+        // Executions left out because their parameters could not be recovered
+        uint64_t unparsed() const
+        {
+            return _unparsed;
+        }
+
+        static constexpr char magic[8] = {'S', 'Q', 'L', 'W', 'L', 'O', 'G', '1'};
+
+    private:
+        struct connection
+        {
+            connection(workload_log *log, uint32_t id, sqlite3 *handle)
+                : log(log)
+                , id(id)
+                , handle(handle)
+            {
+            }
+
+            workload_log *log;
+            uint32_t id;
+            // null once detached
+            sqlite3 *handle;
+            std::unordered_map<sqlite3_stmt *, std::chrono::steady_clock::time_point> started;
+            std::vector<workload_value> parameters;
+        };
+
+        static int trace(unsigned int type, void *context, void *statement, void *sql)
+        {
+            auto c = static_cast<connection *>(context);
+            auto s = static_cast<sqlite3_stmt *>(statement);
+
+            if (type == SQLITE_TRACE_STMT)
+            {
+                // trigger programs are reported as "-- <trigger>"
+                if (std::strncmp(static_cast<const char *>(sql), "--", 2) != 0)
+                {
+                    c->started.emplace(s, std::chrono::steady_clock::now());
+                }
+                return 0;
+            }
+
+            auto it = c->started.find(s);
+            if (it == c->started.end())
+            {
+                return 0;
+            }
+
+            auto end = std::chrono::steady_clock::now();
+            auto start = it->second;
+            c->started.erase(it);
+
+            // exceptions must not unwind through SQLite
+            auto text = sqlite3_sql(s);
+            auto expanded = sqlite3_expanded_sql(s);
+            try
+            {
+                if (text && expanded && detail::parse_parameters(s, text, expanded, c->parameters))
+                {
+                    detail::workload_bindings::apply(s, c->parameters);
+                    c->log->record(c->id, text, start, end, c->parameters);
+                }
+                else
+                {
+                    ++c->log->_unparsed;
+                }
+            }
+            catch (...)
+            {
+                ++c->log->_unparsed;
+            }
+            sqlite3_free(expanded);
+
+            return 0;
+        }
+
+        void record(uint32_t connection, const char *sql, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end,
+            const std::vector<workload_value> &parameters)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            auto it = _statements.find(sql);
+            if (it == _statements.end())
+            {
+                it = _statements.emplace(sql, static_cast<uint32_t>(_statements.size())).first;
+
+                _buffer += 'S';
+                detail::write_varint(_buffer, it->second);
+                detail::write_varint(_buffer, it->first.size());
+                _buffer += it->first;
+            }
+
+            _buffer += 'E';
+            detail::write_varint(_buffer, it->second);
+            detail::write_varint(_buffer, connection);
+            detail::write_varint(_buffer, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(start - _start).count()));
+            detail::write_varint(_buffer, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+            detail::write_varint(_buffer, parameters.size());
+            for (const auto &value : parameters)
+            {
+                _buffer += static_cast<char>(value.type);
+                switch (value.type)
+                {
+                case SQLITE_INTEGER:
+                    // zigzag keeps small negative numbers short
+                    detail::write_varint(_buffer, (static_cast<uint64_t>(value.integer) << 1) ^ static_cast<uint64_t>(value.integer >> 63));
+                    break;
+                case SQLITE_FLOAT:
+                    _buffer.append(reinterpret_cast<const char *>(&value.real), sizeof(value.real));
+                    break;
+                case SQLITE_TEXT:
+                case SQLITE_BLOB:
+                    detail::write_varint(_buffer, value.bytes.size());
+                    _buffer += value.bytes;
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            if (_buffer.size() >= 64 * 1024)
+            {
+                _file.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+                _buffer.clear();
+            }
+        }
+
+        std::mutex _mutex;
+        std::ofstream _file;
+        std::string _buffer;
+        std::chrono::steady_clock::time_point _start;
+        std::unordered_map<std::string, uint32_t> _statements;
+        std::list<connection> _connections;
+        std::atomic<uint64_t> _unparsed{0};
+    };
+
+    class workload_log_reader
+    {
+    public:
+        explicit workload_log_reader(const std::string &filename)
+            : _file(filename, std::ios::binary)
+        {
+            char magic[sizeof(workload_log::magic)];
+            if (!_file.read(magic, sizeof(magic)) || std::memcmp(magic, workload_log::magic, sizeof(magic)) != 0)
+            {
+                throw std::runtime_error(filename + " is not a workload log");
+            }
+        }
+
+        // Statement texts by id, grows while the log is read
+        const std::vector<std::string> &statements() const
+        {
+            return _statements;
+        }
+
+        bool next(workload_execution &execution)
+        {
+            for (;;)
+            {
+                auto type = _file.get();
+                if (type == std::char_traits<char>::eof())
+                {
+                    return false;
+                }
+
+                uint64_t id;
+                if (type == 'S')
+                {
+                    uint64_t size;
+                    if (!detail::read_varint(_file, id) || !detail::read_varint(_file, size))
+                    {
+                        throw std::runtime_error("truncated workload log");
+                    }
+
+                    _statements.resize(std::max(_statements.size(), static_cast<size_t>(id + 1)));
+                    _statements[id].resize(size);
+                    if (size > 0 && !_file.read(&_statements[id][0], static_cast<std::streamsize>(size)))
+                    {
+                        throw std::runtime_error("truncated workload log");
+                    }
+                    continue;
+                }
+
+                if (type != 'E')
+                {
+                    throw std::runtime_error("corrupted workload log");
+                }
+
+                uint64_t connection, count;
+                if (!detail::read_varint(_file, id) || !detail::read_varint(_file, connection) || !detail::read_varint(_file, execution.start_us)
+                    || !detail::read_varint(_file, execution.duration_ns) || !detail::read_varint(_file, count))
+                {
+                    throw std::runtime_error("truncated workload log");
+                }
+                execution.statement = static_cast<uint32_t>(id);
+                execution.connection = static_cast<uint32_t>(connection);
+
+                execution.parameters.resize(count);
+                for (auto &value : execution.parameters)
+                {
+                    read_value(value);
+                }
+
+                return true;
+            }
+        }
+
+    private:
+        void read_value(workload_value &value)
+        {
+            value.type = _file.get();
+
+            uint64_t data = 0;
+            switch (value.type)
+            {
+            case SQLITE_INTEGER:
+                detail::read_varint(_file, data);
+                value.integer = static_cast<int64_t>(data >> 1) ^ -static_cast<int64_t>(data & 1);
+                break;
+            case SQLITE_FLOAT:
+                _file.read(reinterpret_cast<char *>(&value.real), sizeof(value.real));
+                break;
+            case SQLITE_TEXT:
+            case SQLITE_BLOB:
+                detail::read_varint(_file, data);
+                value.bytes.resize(data);
+                if (data > 0)
+                {
+                    _file.read(&value.bytes[0], static_cast<std::streamsize>(data));
+                }
+                break;
+            case SQLITE_NULL:
+                break;
+            default:
+                throw std::runtime_error("corrupted workload log");
+            }
+
+            if (!_file)
+            {
+                throw std::runtime_error("truncated workload log");
+            }
+        }
+
+        std::ifstream _file;
+        std::vector<std::string> _statements;
+    };
+}
@@ -2,8 +2,21 @@
 
 #include <sqlite3.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <boost/optional.hpp>  // Use Boost.Optional for C++11 compatibility
 
 namespace sqlite3_wrapper
@@ -13,11 +26,13 @@ namespace sqlite3_wrapper
     public:
         exception(const std::string& sql, sqlite3 *db)
             : std::runtime_error("'" + sql + "' failed: " + sqlite3_errmsg(db))
+            , _code(sqlite3_extended_errcode(db))
         {
         }
 
         exception(sqlite3 *db)
             : std::runtime_error(sqlite3_errmsg(db))
+            , _code(sqlite3_extended_errcode(db))
         {
         }
 
@@ -25,8 +40,252 @@ namespace sqlite3_wrapper
             : exception(sqlite3_db_handle(statement))
         {
         }
+
+        // Extended result code, e.g. SQLITE_BUSY_SNAPSHOT
+        int code() const
+        {
+            return _code;
+        }
+
+        bool busy() const
+        {
+            return (_code & 0xff) == SQLITE_BUSY || (_code & 0xff) == SQLITE_LOCKED;
+        }
+
+    private:
+        int _code;
     };
 
+    namespace detail
+    {
+        // Owner thread of a connection without a mutex (threading_mode::MULTI_THREAD), kept by debug builds only.
+        // The first thread using the connection owns it until db::attach_to_current_thread().
+        class thread_owner
+        {
+        public:
+            void check()
+            {
+                auto current = std::this_thread::get_id();
+                if (_owner.load(std::memory_order_relaxed) == current)
+                {
+                    return;
+                }
+
+                auto owner = std::thread::id();
+                if (!_owner.compare_exchange_strong(owner, current))
+                {
+                    assert(owner == current && "connection opened with threading_mode::MULTI_THREAD is used by another thread");
+                }
+            }
+
+            void attach()
+            {
+                _owner = std::this_thread::get_id();
+            }
+
+        private:
+            std::atomic<std::thread::id> _owner{std::thread::id()};
+        };
+
+        // "file:" URI of a filename, escaping the characters that end or escape its path
+        inline std::string file_uri(const std::string &filename)
+        {
+            std::string uri = "file:";
+            for (auto c : filename)
+            {
+                switch (c)
+                {
+                case '%':
+                    uri += "%25";
+                    break;
+                case '?':
+                    uri += "%3f";
+                    break;
+                case '#':
+                    uri += "%23";
+                    break;
+                default:
+                    uri += c;
+                    break;
+                }
+            }
+
+            return uri;
+        }
+
+        // Statement being stepped on the current thread, read by I/O instrumentation such as io_accounting
+        inline sqlite3_stmt *&current_statement()
+        {
+            thread_local sqlite3_stmt *statement = nullptr;
+            return statement;
+        }
+
+        // Value bound through statement as SQLite stores it, type 0 for types without a description below
+        struct bound_value
+        {
+            int type = 0;
+            int64_t integer = 0;
+            double real = 0;
+            // text or blob
+            const char *data = nullptr;
+            size_t size = 0;
+        };
+
+        // Called with every value bound through statement, installed by instrumentation such as workload_log.
+        // Unset it costs one relaxed load per bound value.
+        using bind_hook = void (*)(sqlite3_stmt *statement, int index, const bound_value &value);
+
+        inline std::atomic<bind_hook> &current_bind_hook()
+        {
+            static std::atomic<bind_hook> hook{nullptr};
+            return hook;
+        }
+
+        // Mirrors what type_traits<T>::bind stores for the built-in types
+        template<class T, class Enable = void>
+        struct describe_bound
+        {
+            static bound_value describe(const T &)
+            {
+                return bound_value();
+            }
+        };
+
+        inline bound_value integer_value(int64_t integer)
+        {
+            bound_value value;
+            value.type = SQLITE_INTEGER;
+            value.integer = integer;
+
+            return value;
+        }
+
+        inline bound_value text_value(const char *data, size_t size)
+        {
+            bound_value value;
+            value.type = data ? SQLITE_TEXT : SQLITE_NULL;
+            value.data = data;
+            value.size = size;
+
+            return value;
+        }
+
+        template<>
+        struct describe_bound<bool>
+        {
+            static bound_value describe(bool arg)
+            {
+                return integer_value(arg ? 1 : 0);
+            }
+        };
+
+        template<class T>
+        struct describe_bound<T, typename std::enable_if<std::is_integral<T>::value && sizeof(T) <= 4>::type>
+        {
+            static bound_value describe(T arg)
+            {
+                return integer_value(static_cast<int>(arg));
+            }
+        };
+
+        template<class T>
+        struct describe_bound<T, typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 8>::type>
+        {
+            static bound_value describe(T arg)
+            {
+                return integer_value(static_cast<int64_t>(arg));
+            }
+        };
+
+        template<class T>
+        struct describe_bound<T, typename std::enable_if<std::is_enum<T>::value>::type>
+        {
+            static bound_value describe(T arg)
+            {
+                using type = typename std::underlying_type<T>::type;
+                return describe_bound<type>::describe(static_cast<type>(arg));
+            }
+        };
+
+        template<>
+        struct describe_bound<double>
+        {
+            static bound_value describe(double arg)
+            {
+                bound_value value;
+                value.type = SQLITE_FLOAT;
+                value.real = arg;
+
+                return value;
+            }
+        };
+
+        template<>
+        struct describe_bound<const char *>
+        {
+            static bound_value describe(const char *arg)
+            {
+                return text_value(arg, arg ? std::strlen(arg) : 0);
+            }
+        };
+
+        template<int Size>
+        struct describe_bound<char[Size]>
+        {
+            static bound_value describe(const char (&arg)[Size])
+            {
+                return text_value(arg, Size - 1);
+            }
+        };
+
+        template<>
+        struct describe_bound<std::string>
+        {
+            static bound_value describe(const std::string &arg)
+            {
+                return text_value(arg.c_str(), arg.size());
+            }
+        };
+
+        template<>
+        struct describe_bound<std::nullptr_t>
+        {
+            static bound_value describe(std::nullptr_t)
+            {
+                bound_value value;
+                value.type = SQLITE_NULL;
+
+                return value;
+            }
+        };
+
+        template<class T>
+        struct describe_bound<boost::optional<T>>
+        {
+            static bound_value describe(const boost::optional<T> &arg)
+            {
+                return arg ? describe_bound<T>::describe(*arg) : describe_bound<std::nullptr_t>::describe(nullptr);
+            }
+        };
+    }
+
+#if defined(SQLITE_ENABLE_STMT_SCANSTATUS) && SQLITE_VERSION_NUMBER >= 3042000
+    // One element of a statement's query plan with its runtime counters (sqlite3_stmt_scanstatus_v2)
+    struct scan_status
+    {
+        int select_id = 0;
+        int parent_id = 0;
+        std::string name;
+        std::string explain;
+        // number of times the loop ran and rows it visited, negative if not a loop
+        int64_t loops = -1;
+        int64_t rows_visited = -1;
+        double estimated_rows = -1;
+        // CPU cycles spent in the element, negative if unavailable
+        int64_t cycles = -1;
+    };
+#endif
+
     enum class bind_policy
     {
         STATIC,
@@ -44,18 +303,15 @@ namespace sqlite3_wrapper
     {
     public:
         statement(sqlite3 *db, const std::string& sql, unsigned int prepare_flags = 0)
+            : statement(db, sql, prepare_flags, nullptr)
         {
-            auto res = sqlite3_prepare_v3(db, sql.c_str(), static_cast<int>(sql.size()), prepare_flags, &_statement, nullptr);
-            if (res != SQLITE_OK)
-            {
-                throw exception(sql, db);
-            }
         }
 
         statement(statement &&another)
         {
             std::swap(_statement, another._statement);
             std::swap(_can_fetch, another._can_fetch);
+            std::swap(_owner, another._owner);
         }
 
         statement(const statement &) = delete;
@@ -64,6 +320,7 @@ namespace sqlite3_wrapper
         {
             std::swap(_statement, another._statement);
             std::swap(_can_fetch, another._can_fetch);
+            std::swap(_owner, another._owner);
             return *this;
         }
 
@@ -77,6 +334,11 @@ namespace sqlite3_wrapper
             }
         }
 
+        sqlite3_stmt *native_handle()
+        {
+            return _statement;
+        }
+
         template<class... Args>
         void execute(const Args &... args)
         {
@@ -112,19 +374,155 @@ namespace sqlite3_wrapper
             return false;
         }
 
-    private:
         void reset()
         {
-            auto res = sqlite3_reset(_statement);
+            if (!try_reset())
+            {
+                throw exception(_statement);
+            }
+        }
+
+        // reset() without throwing, returns false if the last step failed (sqlite3_reset reports its error),
+        // the statement is reset either way
+        bool try_reset() noexcept
+        {
+            check_thread();
+            _can_fetch = false;
+
+            return sqlite3_reset(_statement) == SQLITE_OK;
+        }
+
+        template<class T>
+        void bind_value(int index, const T &arg, bind_policy policy = bind_policy::TRANSIENT)
+        {
+            auto res = type_traits<T>::bind(_statement, index, arg, policy);
             if (res != SQLITE_OK)
             {
                 throw exception(_statement);
             }
+            observe_bind(index, arg);
+        }
+
+#if defined(SQLITE_ENABLE_STMT_SCANSTATUS) && SQLITE_VERSION_NUMBER >= 3042000
+        // Per-loop profile of the statement, available in builds with SQLITE_ENABLE_STMT_SCANSTATUS
+        std::vector<sqlite3_wrapper::scan_status> scan_status() const
+        {
+            std::vector<sqlite3_wrapper::scan_status> result;
+
+            for (int i = 0;; ++i)
+            {
+                sqlite3_wrapper::scan_status status;
+                const char *text = nullptr;
+                if (sqlite3_stmt_scanstatus_v2(_statement, i, SQLITE_SCANSTAT_SELECTID, SQLITE_SCANSTAT_COMPLEX, &status.select_id) != 0)
+                {
+                    break;
+                }
+
+                sqlite3_stmt_scanstatus_v2(_statement, i, SQLITE_SCANSTAT_PARENTID, SQLITE_SCANSTAT_COMPLEX, &status.parent_id);
+                if (sqlite3_stmt_scanstatus_v2(_statement, i, SQLITE_SCANSTAT_NAME, SQLITE_SCANSTAT_COMPLEX, &text) == 0 && text)
+                {
+                    status.name = text;
+                }
+                if (sqlite3_stmt_scanstatus_v2(_statement, i, SQLITE_SCANSTAT_EXPLAIN, SQLITE_SCANSTAT_COMPLEX, &text) == 0 && text)
+                {
+                    status.explain = text;
+                }
+
+                sqlite3_int64 value;
+                if (sqlite3_stmt_scanstatus_v2(_statement, i, SQLITE_SCANSTAT_NLOOP, SQLITE_SCANSTAT_COMPLEX, &value) == 0)
+                {
+                    status.loops = value;
+                }
+                if (sqlite3_stmt_scanstatus_v2(_statement, i, SQLITE_SCANSTAT_NVISIT, SQLITE_SCANSTAT_COMPLEX, &value) == 0)
+                {
+                    status.rows_visited = value;
+                }
+                if (sqlite3_stmt_scanstatus_v2(_statement, i, SQLITE_SCANSTAT_NCYCLE, SQLITE_SCANSTAT_COMPLEX, &value) == 0)
+                {
+                    status.cycles = value;
+                }
+                sqlite3_stmt_scanstatus_v2(_statement, i, SQLITE_SCANSTAT_EST, SQLITE_SCANSTAT_COMPLEX, &status.estimated_rows);
+
+                result.push_back(std::move(status));
+            }
+
+            return result;
+        }
+
+        // Query plan tree annotated with loops, actual vs estimated rows and cycles
+        std::string scan_status_report() const
+        {
+            auto elements = scan_status();
+
+            std::unordered_map<int, int> depths;
+            std::string report;
+            sqlite3_int64 total_cycles = 0;
+            sqlite3_stmt_scanstatus_v2(_statement, -1, SQLITE_SCANSTAT_NCYCLE, SQLITE_SCANSTAT_COMPLEX, &total_cycles);
+
+            for (const auto &element : elements)
+            {
+                auto parent = depths.find(element.parent_id);
+                auto depth = parent == depths.end() ? 0 : parent->second + 1;
+                depths[element.select_id] = depth;
+
+                report += std::string(static_cast<size_t>(depth) * 2, ' ') + (element.explain.empty() ? element.name : element.explain);
+                if (element.loops >= 0)
+                {
+                    report += " (loops=" + std::to_string(element.loops) + " rows=" + std::to_string(element.rows_visited)
+                        + " est=" + std::to_string(static_cast<int64_t>(element.estimated_rows)) + ")";
+                }
+                if (element.cycles >= 0)
+                {
+                    report += " cycles=" + std::to_string(element.cycles);
+                    if (total_cycles > 0)
+                    {
+                        report += " (" + std::to_string(element.cycles * 100 / total_cycles) + "%)";
+                    }
+                }
+                report += "\n";
+            }
+
+            return report;
+        }
+
+        void reset_scan_status()
+        {
+            sqlite3_stmt_scanstatus_reset(_statement);
+        }
+#endif
+
+    private:
+        friend class db;
+
+        statement(sqlite3 *db, const std::string& sql, unsigned int prepare_flags, std::shared_ptr<detail::thread_owner> owner)
+            : _owner(std::move(owner))
+        {
+            check_thread();
+            auto res = sqlite3_prepare_v3(db, sql.c_str(), static_cast<int>(sql.size()), prepare_flags, &_statement, nullptr);
+            if (res != SQLITE_OK)
+            {
+                throw exception(sql, db);
+            }
+        }
+
+        void check_thread()
+        {
+            if (_owner)
+            {
+                _owner->check();
+            }
         }
 
         void step()
         {
+            check_thread();
+
+            auto &current = detail::current_statement();
+            auto previous = current;
+            current = _statement;
             auto res = sqlite3_step(_statement);
+            current = previous;
+
             if (res != SQLITE_ROW && res != SQLITE_DONE)
             {
                 throw exception(_statement);
@@ -145,10 +543,21 @@ namespace sqlite3_wrapper
             {
                 throw exception(_statement);
             }
+            observe_bind(Index, arg);
 
             bind<Index + 1>(policy, args...);
         }
 
+        template<class T>
+        void observe_bind(int index, const T &arg)
+        {
+            auto hook = detail::current_bind_hook().load(std::memory_order_relaxed);
+            if (hook)
+            {
+                hook(_statement, index, detail::describe_bound<T>::describe(arg));
+            }
+        }
+
         template<int Column = 0>
         void column()
         {
@@ -163,6 +572,355 @@ namespace sqlite3_wrapper
 
         bool _can_fetch = false;
         sqlite3_stmt *_statement = nullptr;
+        // set for connections checked by debug builds, see detail::thread_owner
+        std::shared_ptr<detail::thread_owner> _owner;
+    };
+
+    // Reads a single text/blob column by rowid through sqlite3_blob, bypassing statement execution.
+    // An open blob handle holds a read transaction, so it is kept between reads only while the connection is in
+    // a transaction, where sqlite3_blob_reopen moves it between rows. Outside one every read opens and closes it,
+    // which is slower than a prepared SELECT, so batches of reads belong in a transaction.
+    // A handle kept from a transaction that has ended is closed by the next read or release().
+    class point_reader
+    {
+    public:
+        point_reader(sqlite3 *db, const std::string &table, const std::string &column, const std::string &schema = "main")
+            : _db(db)
+            , _table(table)
+            , _column(column)
+            , _schema(schema)
+        {
+            // validates table and column names, sqlite3_blob_open needs an existing row for that
+            statement validate(db, "SELECT " + column + " FROM " + schema + "." + table + " LIMIT 0");
+        }
+
+        point_reader(point_reader &&another)
+        {
+            swap(another);
+        }
+
+        point_reader(const point_reader &) = delete;
+
+        point_reader &operator=(point_reader &&another)
+        {
+            swap(another);
+            return *this;
+        }
+
+        point_reader &operator=(const point_reader &) = delete;
+
+        ~point_reader()
+        {
+            release();
+        }
+
+        bool read(int64_t rowid, std::string &value)
+        {
+            if (!seek(rowid))
+            {
+                return false;
+            }
+
+            value.resize(static_cast<size_t>(sqlite3_blob_bytes(_blob)));
+            read_blob(&value[0], static_cast<int>(value.size()));
+            finish();
+
+            return true;
+        }
+
+        // Copies up to size bytes into buffer, returns the full value size or -1 if there is no such row
+        int read(int64_t rowid, void *buffer, int size)
+        {
+            if (!seek(rowid))
+            {
+                return -1;
+            }
+
+            auto bytes = sqlite3_blob_bytes(_blob);
+            read_blob(buffer, std::min(size, bytes));
+            finish();
+
+            return bytes;
+        }
+
+        void release()
+        {
+            if (_blob)
+            {
+                sqlite3_blob_close(_blob);
+                _blob = nullptr;
+            }
+        }
+
+    private:
+        void swap(point_reader &another)
+        {
+            std::swap(_db, another._db);
+            std::swap(_blob, another._blob);
+            std::swap(_table, another._table);
+            std::swap(_column, another._column);
+            std::swap(_schema, another._schema);
+        }
+
+        bool seek(int64_t rowid)
+        {
+            // the snapshot of a handle kept from an ended transaction is stale
+            finish();
+
+            int res = SQLITE_ABORT;
+            if (_blob)
+            {
+                res = sqlite3_blob_reopen(_blob, rowid);
+                if (res == SQLITE_OK)
+                {
+                    return true;
+                }
+                release();
+            }
+
+            // expired handle (row changed through this connection) has to be opened again
+            if (res == SQLITE_ABORT)
+            {
+                res = sqlite3_blob_open(_db, _schema.c_str(), _table.c_str(), _column.c_str(), rowid, 0, &_blob);
+                if (res == SQLITE_OK)
+                {
+                    return true;
+                }
+                release();
+            }
+
+            // missing row or NULL/numeric value
+            if (res == SQLITE_ERROR)
+            {
+                return false;
+            }
+
+            throw exception(_db);
+        }
+
+        void finish()
+        {
+            if (sqlite3_get_autocommit(_db))
+            {
+                release();
+            }
+        }
+
+        void read_blob(void *buffer, int size)
+        {
+            if (size > 0 && sqlite3_blob_read(_blob, buffer, size, 0) != SQLITE_OK)
+            {
+                release();
+                throw exception(_db);
+            }
+        }
+
+        sqlite3 *_db = nullptr;
+        sqlite3_blob *_blob = nullptr;
+        std::string _table;
+        std::string _column;
+        std::string _schema;
+    };
+
+    enum class commit_source
+    {
+        LOCAL,
+        EXTERNAL
+    };
+
+    struct commit_event
+    {
+        commit_source source;
+        uint64_t generation;
+    };
+
+    // Delivers commits of the owning connection (WAL hook, WAL mode only) and commits of other
+    // connections or processes detected by check() via PRAGMA data_version to subscribers.
+    // Subscribers are called on the thread that committed or called check(). A subscriber throwing during a commit
+    // must not unwind through SQLite: the other subscribers are still called and its exception is kept for
+    // last_error(); check() rethrows it after calling the other subscribers.
+    class commit_notifier
+    {
+    public:
+        using subscriber = std::function<void(const commit_event &)>;
+
+        explicit commit_notifier(sqlite3 *db)
+            : _db(db)
+            , _data_version_statement(db, "PRAGMA data_version", SQLITE_PREPARE_PERSISTENT)
+        {
+            _data_version = data_version();
+
+            // the WAL hook replaces the one of PRAGMA wal_autocheckpoint, its setting (0 is off) is kept
+            statement autocheckpoint(db, "PRAGMA wal_autocheckpoint");
+            autocheckpoint.fetch(_autocheckpoint);
+            sqlite3_wal_hook(_db, &commit_notifier::wal_hook, this);
+        }
+
+        commit_notifier(const commit_notifier &) = delete;
+        commit_notifier &operator=(const commit_notifier &) = delete;
+
+        ~commit_notifier()
+        {
+            sqlite3_wal_hook(_db, nullptr, nullptr);
+        }
+
+        size_t subscribe(subscriber callback)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _subscribers.emplace_back(++_last_subscription, std::make_shared<subscriber>(std::move(callback)));
+
+            return _last_subscription;
+        }
+
+        void unsubscribe(size_t subscription)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _subscribers.erase(std::remove_if(_subscribers.begin(), _subscribers.end(), [subscription](const std::pair<size_t, std::shared_ptr<subscriber>> &s)
+            {
+                return s.first == subscription;
+            }), _subscribers.end());
+        }
+
+        // Must be called on the thread owning the connection, returns true if another connection committed
+        bool check()
+        {
+            auto version = data_version();
+            if (version == _data_version)
+            {
+                return false;
+            }
+
+            _data_version = version;
+            auto error = notify(commit_source::EXTERNAL);
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+
+            return true;
+        }
+
+        uint64_t generation() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _generation;
+        }
+
+        // Can be called from any thread, returns false if no commit was observed past generation before deadline
+        bool wait_until(uint64_t generation, std::chrono::steady_clock::time_point deadline) const
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            return _condition.wait_until(lock, deadline, [this, generation] { return _generation != generation; });
+        }
+
+        // Exception of the last subscriber that threw during a commit of this connection
+        std::exception_ptr last_error() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _last_error;
+        }
+
+        // The WAL hook replaces the one of sqlite3_wal_autocheckpoint() and PRAGMA wal_autocheckpoint,
+        // which must not be used while notifications are active, pages <= 0 disables checkpoints
+        void set_autocheckpoint(int pages)
+        {
+            _autocheckpoint = pages;
+        }
+
+    private:
+        static int wal_hook(void *notifier, sqlite3 *db, const char *schema, int pages)
+        {
+            auto self = static_cast<commit_notifier *>(notifier);
+            if (self->_autocheckpoint > 0 && pages >= self->_autocheckpoint)
+            {
+                sqlite3_wal_checkpoint(db, schema);
+            }
+
+            auto error = self->notify(commit_source::LOCAL);
+            if (error)
+            {
+                std::lock_guard<std::mutex> lock(self->_mutex);
+                self->_last_error = error;
+            }
+
+            return SQLITE_OK;
+        }
+
+        // Calls every subscriber, returns the exception of the first one that threw
+        std::exception_ptr notify(commit_source source)
+        {
+            std::vector<std::shared_ptr<subscriber>> subscribers;
+            commit_event event{source, 0};
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                event.generation = ++_generation;
+                for (const auto &s : _subscribers)
+                {
+                    subscribers.push_back(s.second);
+                }
+            }
+            _condition.notify_all();
+
+            std::exception_ptr error;
+            for (const auto &callback : subscribers)
+            {
+                try
+                {
+                    (*callback)(event);
+                }
+                catch (...)
+                {
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                }
+            }
+
+            return error;
+        }
+
+        int64_t data_version()
+        {
+            int64_t version = 0;
+
+            _data_version_statement.execute();
+            _data_version_statement.fetch(version);
+            _data_version_statement.reset();
+
+            return version;
+        }
+
+        sqlite3 *_db;
+        statement _data_version_statement;
+        int64_t _data_version = 0;
+        int _autocheckpoint = 0;
+
+        mutable std::mutex _mutex;
+        mutable std::condition_variable _condition;
+        uint64_t _generation = 0;
+        std::exception_ptr _last_error;
+        size_t _last_subscription = 0;
+        std::vector<std::pair<size_t, std::shared_ptr<subscriber>>> _subscribers;
+    };
+
+    enum class threading_mode
+    {
+        DEFAULT,
+        // SQLITE_OPEN_FULLMUTEX, connection can be shared between threads
+        SERIALIZED,
+        // SQLITE_OPEN_NOMUTEX, no connection mutex, connection must be confined to one thread at a time
+        MULTI_THREAD
+    };
+
+    // Profile for reference databases which never change while opened: no locking and no change
+    // detection (URI immutable=1). The database must not have an un-checkpointed WAL.
+    struct immutable_options
+    {
+        // Copies the whole database into memory with sqlite3_serialize/sqlite3_deserialize
+        bool in_memory = false;
+        int64_t mmap_size = 1ll << 30;
+        threading_mode threading = threading_mode::DEFAULT;
     };
 
     enum class transaction_type
@@ -175,19 +933,62 @@ namespace sqlite3_wrapper
     class db
     {
     public:
-        db(const std::string& filename, int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE)
+        // vfs is the name of a registered VFS, e.g. a vfs_shim, null for the default one
+        db(const std::string& filename, int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, const char *vfs = nullptr)
         {
-            auto res = sqlite3_open_v2(filename.c_str(), &_db, flags, nullptr);
+            auto res = sqlite3_open_v2(filename.c_str(), &_db, flags, vfs);
             if (res != SQLITE_OK)
             {
+                exception e(_db);
                 sqlite3_close_v2(_db);
-                throw exception(_db);
+                _db = nullptr;
+                throw e;
             }
+
+#ifndef NDEBUG
+            if (!sqlite3_db_mutex(_db))
+            {
+                _thread_owner = std::make_shared<detail::thread_owner>();
+            }
+#endif
+        }
+
+        db(const std::string& filename, threading_mode mode, int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, const char *vfs = nullptr)
+            : db(filename, flags | threading_flags(mode), vfs)
+        {
+        }
+
+        db(const std::string& filename, const immutable_options &options)
+            : db(immutable_uri(filename), SQLITE_OPEN_READONLY | SQLITE_OPEN_URI | threading_flags(options.threading))
+        {
+            if (options.in_memory)
+            {
+                sqlite3_int64 size = 0;
+                auto data = sqlite3_serialize(_db, "main", &size, 0);
+                if (!data)
+                {
+                    throw exception(_db);
+                }
+
+                auto res = sqlite3_deserialize(_db, "main", data, size, size, SQLITE_DESERIALIZE_FREEONCLOSE | SQLITE_DESERIALIZE_READONLY);
+                if (res != SQLITE_OK)
+                {
+                    throw exception(_db);
+                }
+            }
+            else
+            {
+                execute("PRAGMA mmap_size = " + std::to_string(options.mmap_size));
+            }
+
+            execute("PRAGMA query_only = 1");
         }
 
         db(db &&another)
         {
             std::swap(_db, another._db);
+            std::swap(_commit_notifier, another._commit_notifier);
+            std::swap(_thread_owner, another._thread_owner);
         }
 
         db(const db &) = delete;
@@ -195,6 +996,8 @@ namespace sqlite3_wrapper
         db &operator=(db &&another)
         {
             std::swap(_db, another._db);
+            std::swap(_commit_notifier, another._commit_notifier);
+            std::swap(_thread_owner, another._thread_owner);
             return *this;
         }
 
@@ -202,6 +1005,7 @@ namespace sqlite3_wrapper
 
         ~db()
         {
+            _commit_notifier.reset();
             if (_db)
             {
                 sqlite3_close_v2(_db);
@@ -213,6 +1017,30 @@ namespace sqlite3_wrapper
             return _db;
         }
 
+        // Moves ownership of a threading_mode::MULTI_THREAD connection to the calling thread, e.g. when a pool hands it out
+        void attach_to_current_thread()
+        {
+            if (_thread_owner)
+            {
+                _thread_owner->attach();
+            }
+        }
+
+        bool autocommit() const
+        {
+            return sqlite3_get_autocommit(_db) != 0;
+        }
+
+        int changes() const
+        {
+            return sqlite3_changes(_db);
+        }
+
+        int64_t last_insert_rowid() const
+        {
+            return sqlite3_last_insert_rowid(_db);
+        }
+
         void begin(transaction_type type = transaction_type::DEFERRED)
         {
             switch (type)
@@ -242,20 +1070,58 @@ namespace sqlite3_wrapper
 
         statement prepare(const std::string& sql, unsigned int prepare_flags = SQLITE_PREPARE_PERSISTENT)
         {
-            return statement(_db, sql, prepare_flags);
+            return statement(_db, sql, prepare_flags, _thread_owner);
         }
 
         template<class... Args>
         statement execute(const std::string& sql, const Args &... args)
         {
-            statement s(_db, sql);
+            statement s(_db, sql, 0, _thread_owner);
             s.execute(args...);
 
             return s;
         }
 
+        // Created on first use, installs the WAL hook of the connection
+        commit_notifier &commits()
+        {
+            if (!_commit_notifier)
+            {
+                _commit_notifier.reset(new commit_notifier(_db));
+            }
+
+            return *_commit_notifier;
+        }
+
+        point_reader open_point_reader(const std::string &table, const std::string &column, const std::string &schema = "main")
+        {
+            return point_reader(_db, table, column, schema);
+        }
+
     private:
+        static std::string immutable_uri(const std::string &filename)
+        {
+            return detail::file_uri(filename) + "?mode=ro&immutable=1";
+        }
+
+        static int threading_flags(threading_mode mode)
+        {
+            switch (mode)
+            {
+            default:
+            case threading_mode::DEFAULT:
+                return 0;
+            case threading_mode::SERIALIZED:
+                return SQLITE_OPEN_FULLMUTEX;
+            case threading_mode::MULTI_THREAD:
+                return SQLITE_OPEN_NOMUTEX;
+            }
+        }
+
         sqlite3 *_db = nullptr;
+        std::unique_ptr<commit_notifier> _commit_notifier;
+        // debug builds only, shared with the statements of the connection
+        std::shared_ptr<detail::thread_owner> _thread_owner;
     };
 
     template<>
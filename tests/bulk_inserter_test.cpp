@@ -0,0 +1,86 @@
+#include <sqlite3_wrapper/sqlite3_bulk_inserter.h>
+
+#include "test.h"
+
+#include <cstdio>
+
+namespace sqlite = sqlite3_wrapper;
+namespace test = sqlite3_wrapper_test;
+
+namespace
+{
+    int64_t count(sqlite::db &db)
+    {
+        int64_t count = 0;
+        db.execute("SELECT COUNT(*) FROM t").fetch(count);
+
+        return count;
+    }
+
+    void failed_flush_keeps_rows()
+    {
+        sqlite::db db(":memory:");
+        db.execute("CREATE TABLE t(k INTEGER PRIMARY KEY, v INTEGER UNIQUE)");
+        db.execute("INSERT INTO t VALUES (0, 2)");
+        sqlite::bulk_inserter<int64_t, int64_t> inserter(db, "INSERT INTO t VALUES (?, ?)", 10);
+        inserter.insert(1, 1);
+        inserter.insert(2, 2);
+
+        bool failed = false;
+        try
+        {
+            inserter.flush();
+        }
+        catch (const sqlite::exception &)
+        {
+            failed = true;
+        }
+        CHECK(failed);
+        CHECK(inserter.pending() == 2);
+        CHECK(count(db) == 1);
+
+        // the batch is retried once the conflict is gone
+        db.execute("DELETE FROM t");
+        inserter.flush();
+        CHECK(inserter.pending() == 0);
+        CHECK(count(db) == 2);
+
+        inserter.insert(3, 3);
+        inserter.discard();
+        inserter.flush();
+        CHECK(count(db) == 2);
+    }
+
+    void c_strings_are_copied()
+    {
+        sqlite::db db(":memory:");
+        db.execute("CREATE TABLE t(k TEXT PRIMARY KEY, v TEXT)");
+        sqlite::bulk_inserter<const char *, const char *> inserter(db, "INSERT OR REPLACE INTO t VALUES (?, ?)", 10);
+        inserter.sort_by_key<0>();
+
+        // one reused buffer, equal keys at different addresses are deduplicated, the last one wins
+        char buffer[8];
+        std::string b = "b";
+        for (auto value : {"b", "a", "c"})
+        {
+            std::snprintf(buffer, sizeof(buffer), "%s", value);
+            inserter.insert(buffer, value);
+        }
+        inserter.insert(b.c_str(), nullptr);
+        std::snprintf(buffer, sizeof(buffer), "x");
+        inserter.flush();
+
+        CHECK(count(db) == 3);
+        int64_t nulls = 0;
+        db.execute("SELECT COUNT(*) FROM t WHERE k = 'b' AND v IS NULL").fetch(nulls);
+        CHECK(nulls == 1);
+    }
+}
+
+int main()
+{
+    return test::run({
+        {"failed_flush_keeps_rows", failed_flush_keeps_rows},
+        {"c_strings_are_copied", c_strings_are_copied},
+    });
+}
@@ -0,0 +1,84 @@
+#include <sqlite3_wrapper/sqlite3_wrapper.h>
+
+#include "test.h"
+
+#include <cstdio>
+
+namespace sqlite = sqlite3_wrapper;
+namespace test = sqlite3_wrapper_test;
+
+// Built as C++11 to keep the core header usable without C++14
+namespace
+{
+    const std::string filename = "commit_notifier_test.db";
+
+    void remove_database()
+    {
+        for (auto suffix : {"", "-wal", "-shm"})
+        {
+            std::remove((filename + suffix).c_str());
+        }
+    }
+
+    void keeps_autocheckpoint_setting()
+    {
+        remove_database();
+        sqlite::db db(filename);
+        db.execute("PRAGMA journal_mode = WAL");
+        db.execute("PRAGMA synchronous = OFF");
+        db.execute("PRAGMA wal_autocheckpoint = 0");
+        db.execute("CREATE TABLE t(v BLOB)");
+
+        size_t commits = 0;
+        db.commits().subscribe([&commits](const sqlite::commit_event &)
+        {
+            ++commits;
+        });
+        for (int i = 0; i < 1200; ++i)
+        {
+            db.execute("INSERT INTO t VALUES (zeroblob(3000))");
+        }
+        CHECK(commits == 1200);
+
+        // no automatic checkpoint reset the WAL
+        int busy = -1, frames = 0, checkpointed = 0;
+        db.execute("PRAGMA wal_checkpoint(PASSIVE)").fetch(busy, frames, checkpointed);
+        CHECK(frames > 1200);
+        remove_database();
+    }
+
+    void throwing_subscriber()
+    {
+        remove_database();
+        sqlite::db db(filename);
+        db.execute("PRAGMA journal_mode = WAL");
+        db.execute("CREATE TABLE t(v INTEGER)");
+
+        size_t calls = 0;
+        db.commits().subscribe([](const sqlite::commit_event &)
+        {
+            throw std::runtime_error("subscriber failed");
+        });
+        db.commits().subscribe([&calls](const sqlite::commit_event &)
+        {
+            ++calls;
+        });
+
+        db.execute("INSERT INTO t VALUES (1)");
+        CHECK(calls == 1);
+        CHECK(db.commits().last_error() != nullptr);
+
+        int64_t count = 0;
+        db.execute("SELECT COUNT(*) FROM t").fetch(count);
+        CHECK(count == 1);
+        remove_database();
+    }
+}
+
+int main()
+{
+    return test::run({
+        {"keeps_autocheckpoint_setting", keeps_autocheckpoint_setting},
+        {"throwing_subscriber", throwing_subscriber},
+    });
+}
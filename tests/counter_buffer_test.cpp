@@ -0,0 +1,88 @@
+#include <sqlite3_wrapper/sqlite3_counter_buffer.h>
+
+#include "test.h"
+
+#include <cstdio>
+
+namespace sqlite = sqlite3_wrapper;
+namespace test = sqlite3_wrapper_test;
+
+namespace
+{
+    const std::string filename = "counter_buffer_test.db";
+
+    // the trigger fails every flush until it is dropped
+    sqlite::db create_failing_table()
+    {
+        std::remove(filename.c_str());
+        sqlite::db db(filename);
+        db.execute("CREATE TABLE counters(key PRIMARY KEY NOT NULL, value INTEGER NOT NULL) WITHOUT ROWID");
+        db.execute("CREATE TRIGGER counters_fail BEFORE INSERT ON counters BEGIN SELECT RAISE(ABORT, 'flush failed'); END");
+
+        return db;
+    }
+
+    bool flush_fails(sqlite::counter_buffer<> &buffer)
+    {
+        try
+        {
+            buffer.flush();
+        }
+        catch (const sqlite::exception &)
+        {
+            return true;
+        }
+
+        return false;
+    }
+
+    void failed_flush_keeps_deltas()
+    {
+        auto other = create_failing_table();
+        {
+            sqlite::counter_buffer<> buffer(sqlite::db(filename), "counters", std::chrono::hours(1));
+            buffer.add("a", 2);
+            CHECK(flush_fails(buffer));
+            CHECK(buffer.pending().at("a") == 2);
+
+            other.execute("DROP TRIGGER counters_fail");
+            buffer.flush();
+            CHECK(buffer.pending().empty());
+        }
+
+        int64_t value = 0;
+        other.execute("SELECT value FROM counters WHERE key = 'a'").fetch(value);
+        CHECK(value == 2);
+        std::remove(filename.c_str());
+    }
+
+    void destructor_hands_over_unflushed_deltas()
+    {
+        auto other = create_failing_table();
+        std::unordered_map<std::string, int64_t> unflushed;
+        bool error = false;
+        {
+            sqlite::counter_buffer<> buffer(sqlite::db(filename), "counters", std::chrono::hours(1));
+            buffer.on_unflushed([&](std::unordered_map<std::string, int64_t> deltas, std::exception_ptr e)
+            {
+                unflushed = std::move(deltas);
+                error = e != nullptr;
+            });
+            buffer.add("a", 1);
+            buffer.add("b", 3);
+            buffer.add("a", 1);
+        }
+
+        CHECK(unflushed.size() == 2 && unflushed["a"] == 2 && unflushed["b"] == 3);
+        CHECK(error);
+        std::remove(filename.c_str());
+    }
+}
+
+int main()
+{
+    return test::run({
+        {"failed_flush_keeps_deltas", failed_flush_keeps_deltas},
+        {"destructor_hands_over_unflushed_deltas", destructor_hands_over_unflushed_deltas},
+    });
+}
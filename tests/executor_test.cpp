@@ -0,0 +1,76 @@
+#include <sqlite3_wrapper/sqlite3_executor.h>
+#include <sqlite3_wrapper/sqlite3_read_executor.h>
+
+#include "test.h"
+
+namespace sqlite = sqlite3_wrapper;
+namespace test = sqlite3_wrapper_test;
+
+namespace
+{
+    // the second connection fails to open
+    std::function<sqlite::db()> failing_factory()
+    {
+        auto opened = std::make_shared<std::atomic<int>>(0);
+        return [opened]
+        {
+            if (++*opened == 2)
+            {
+                return sqlite::db("/nonexistent/executor_test.db", SQLITE_OPEN_READONLY);
+            }
+            return sqlite::db(":memory:");
+        };
+    }
+
+    void read_executor_reports_failed_open()
+    {
+        bool thrown = false;
+        try
+        {
+            sqlite::read_executor executor(failing_factory(), 3);
+        }
+        catch (const sqlite::exception &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+
+    void query_executor_reports_failed_open()
+    {
+        bool thrown = false;
+        try
+        {
+            sqlite::query_executor executor(failing_factory(), 2, {1});
+        }
+        catch (const sqlite::exception &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+
+    void released_statements_fetch_again()
+    {
+        sqlite::read_executor executor([] { return sqlite::db(":memory:"); }, 1);
+
+        // the row is left unread when the job ends
+        executor.submit([](sqlite::cached_connection &connection) { connection.execute("SELECT 42"); }).get();
+        auto value = executor.submit([](sqlite::cached_connection &connection)
+        {
+            int value = 0;
+            connection.prepare("SELECT 42").fetch(value);
+            return value;
+        }).get();
+        CHECK(value == 42);
+    }
+}
+
+int main()
+{
+    return test::run({
+        {"read_executor_reports_failed_open", read_executor_reports_failed_open},
+        {"query_executor_reports_failed_open", query_executor_reports_failed_open},
+        {"released_statements_fetch_again", released_statements_fetch_again},
+    });
+}
@@ -0,0 +1,67 @@
+#include <sqlite3_wrapper/sqlite3_kv_store.h>
+
+#include "test.h"
+
+namespace sqlite = sqlite3_wrapper;
+namespace test = sqlite3_wrapper_test;
+
+namespace
+{
+    using store = sqlite::kv_store<std::string, std::string>;
+
+    void rollback_discards_put()
+    {
+        sqlite::db db(":memory:");
+        store kv(db, "kv", 16);
+        kv.put("key", "committed");
+
+        db.begin();
+        kv.put("key", "rolled back");
+        CHECK(kv.get("key") == std::string("rolled back"));
+        db.rollback();
+
+        CHECK(kv.get("key") == std::string("committed"));
+        CHECK(kv.pending() == 0);
+    }
+
+    void rollback_discards_erase_and_compare_and_swap()
+    {
+        sqlite::db db(":memory:");
+        store kv(db, "kv", 16);
+        kv.put("a", "1");
+        kv.put("b", "1");
+
+        db.begin();
+        kv.erase("a");
+        CHECK(kv.compare_and_swap("b", "1", "2"));
+        CHECK(!kv.get("a"));
+        db.rollback();
+
+        CHECK(kv.get("a") == std::string("1"));
+        CHECK(kv.get("b") == std::string("1"));
+    }
+
+    void commit_keeps_put()
+    {
+        sqlite::db db(":memory:");
+        store kv(db, "kv", 16);
+
+        db.begin();
+        kv.put("key", "value");
+        db.commit();
+
+        CHECK(kv.get("key") == std::string("value"));
+        // cached once the transaction ended
+        db.execute("UPDATE kv SET value = 'changed behind the cache'");
+        CHECK(kv.get("key") == std::string("value"));
+    }
+}
+
+int main()
+{
+    return test::run({
+        {"rollback_discards_put", rollback_discards_put},
+        {"rollback_discards_erase_and_compare_and_swap", rollback_discards_erase_and_compare_and_swap},
+        {"commit_keeps_put", commit_keeps_put},
+    });
+}
@@ -0,0 +1,91 @@
+#include <sqlite3_wrapper/sqlite3_materialized_aggregate.h>
+
+#include "test.h"
+
+namespace sqlite = sqlite3_wrapper;
+namespace test = sqlite3_wrapper_test;
+
+namespace
+{
+    struct group
+    {
+        std::string g;
+        int64_t count;
+        int64_t sum;
+    };
+
+    std::vector<group> groups(sqlite::db &db)
+    {
+        std::vector<group> groups;
+        auto statement = db.execute("SELECT g, row_count, sum_v FROM agg ORDER BY g");
+        group row;
+        while (statement.fetch(row.g, row.count, row.sum))
+        {
+            groups.push_back(row);
+        }
+
+        return groups;
+    }
+
+    void create_source(sqlite::db &db)
+    {
+        db.execute("CREATE TABLE s(id INTEGER PRIMARY KEY, g TEXT, v INTEGER)");
+    }
+
+    void insert_update_delete()
+    {
+        sqlite::db db(":memory:");
+        create_source(db);
+        db.execute("INSERT INTO s VALUES (1, 'a', 1), (2, 'a', 2), (3, NULL, 3)");
+        sqlite::materialized_aggregate aggregate(db, "agg", "s", {"g"}, {"v"});
+
+        db.execute("INSERT INTO s VALUES (4, 'b', 4)");
+        db.execute("UPDATE s SET g = 'b' WHERE id = 1");
+        db.execute("DELETE FROM s WHERE id = 2");
+
+        auto result = groups(db);
+        CHECK(result.size() == 1);
+        CHECK(result[0].g == "b" && result[0].count == 2 && result[0].sum == 5);
+    }
+
+    void replace_removes_old_row()
+    {
+        sqlite::db db(":memory:");
+        create_source(db);
+        sqlite::materialized_aggregate aggregate(db, "agg", "s", {"g"}, {"v"});
+
+        db.execute("INSERT INTO s VALUES (1, 'a', 10)");
+        db.execute("INSERT OR REPLACE INTO s VALUES (1, 'a', 20)");
+        db.execute("REPLACE INTO s VALUES (1, 'b', 5)");
+
+        auto result = groups(db);
+        CHECK(result.size() == 1);
+        CHECK(result[0].g == "b" && result[0].count == 1 && result[0].sum == 5);
+    }
+
+    void missing_triggers_rebuild()
+    {
+        sqlite::db db(":memory:");
+        create_source(db);
+        {
+            sqlite::materialized_aggregate aggregate(db, "agg", "s", {"g"}, {"v"});
+        }
+        db.execute("DROP TRIGGER agg_insert");
+        db.execute("INSERT INTO s VALUES (1, 'a', 7)");
+
+        sqlite::materialized_aggregate aggregate(db, "agg", "s", {"g"}, {"v"});
+
+        auto result = groups(db);
+        CHECK(result.size() == 1);
+        CHECK(result[0].g == "a" && result[0].count == 1 && result[0].sum == 7);
+    }
+}
+
+int main()
+{
+    return test::run({
+        {"insert_update_delete", insert_update_delete},
+        {"replace_removes_old_row", replace_removes_old_row},
+        {"missing_triggers_rebuild", missing_triggers_rebuild},
+    });
+}
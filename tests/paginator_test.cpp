@@ -0,0 +1,84 @@
+#include <sqlite3_wrapper/sqlite3_paginator.h>
+
+#include "test.h"
+
+namespace sqlite = sqlite3_wrapper;
+namespace test = sqlite3_wrapper_test;
+
+namespace
+{
+    template<class Key>
+    bool rejected(const std::string &data)
+    {
+        try
+        {
+            Key key;
+            sqlite::detail::decode_cursor(sqlite::detail::to_hex(data), key);
+        }
+        catch (const std::invalid_argument &)
+        {
+            return true;
+        }
+
+        return false;
+    }
+
+    void pages()
+    {
+        sqlite::db db(":memory:");
+        db.execute("CREATE TABLE t(id INTEGER PRIMARY KEY, v TEXT)");
+        db.execute("INSERT INTO t VALUES (1, 'a'), (2, 'b'), (3, 'c')");
+        sqlite::paginator<int64_t, std::string> paginator(db, "t", "id", "v", "", 2);
+
+        auto first = paginator.fetch();
+        CHECK(first.rows.size() == 2 && !first.next_cursor.empty());
+        auto second = paginator.fetch(first.next_cursor);
+        CHECK(second.rows.size() == 1 && std::get<0>(second.rows[0]) == 3 && second.next_cursor.empty());
+    }
+
+    void zero_page_size_rejected()
+    {
+        sqlite::db db(":memory:");
+        db.execute("CREATE TABLE t(id INTEGER PRIMARY KEY)");
+
+        bool rejected = false;
+        try
+        {
+            sqlite::paginator<int64_t> paginator(db, "t", "id", "", "", 0);
+        }
+        catch (const std::invalid_argument &)
+        {
+            rejected = true;
+        }
+        CHECK(rejected);
+    }
+
+    void integer_cursors()
+    {
+        int64_t key = 0;
+        sqlite::detail::decode_cursor(sqlite::detail::encode_cursor(std::numeric_limits<int64_t>::min()), key);
+        CHECK(key == std::numeric_limits<int64_t>::min());
+
+        uint64_t unsigned_key = 0;
+        sqlite::detail::decode_cursor(sqlite::detail::encode_cursor(std::numeric_limits<uint64_t>::max()), unsigned_key);
+        CHECK(unsigned_key == std::numeric_limits<uint64_t>::max());
+
+        CHECK(rejected<int64_t>("i12abc"));
+        CHECK(rejected<int64_t>("i 12"));
+        CHECK(rejected<int64_t>("i+12"));
+        CHECK(rejected<int64_t>("i99999999999999999999"));
+        CHECK(rejected<uint64_t>("i-1"));
+        CHECK(rejected<int32_t>("i4294967296"));
+        CHECK(rejected<int64_t>(std::string("i1\0", 3)));
+        CHECK(rejected<int64_t>("s12"));
+    }
+}
+
+int main()
+{
+    return test::run({
+        {"pages", pages},
+        {"zero_page_size_rejected", zero_page_size_rejected},
+        {"integer_cursors", integer_cursors},
+    });
+}
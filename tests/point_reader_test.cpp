@@ -0,0 +1,81 @@
+#include <sqlite3_wrapper/sqlite3_wrapper.h>
+
+#include "test.h"
+
+#include <cstdio>
+
+namespace sqlite = sqlite3_wrapper;
+namespace test = sqlite3_wrapper_test;
+
+namespace
+{
+    const std::string filename = "point_reader_test.db";
+
+    void remove_database()
+    {
+        for (auto suffix : {"", "-wal", "-shm"})
+        {
+            std::remove((filename + suffix).c_str());
+        }
+    }
+
+    sqlite::db open()
+    {
+        sqlite::db db(filename);
+        db.execute("PRAGMA journal_mode = WAL");
+
+        return db;
+    }
+
+    void reads_see_other_commits()
+    {
+        remove_database();
+        auto writer = open();
+        writer.execute("CREATE TABLE t(id INTEGER PRIMARY KEY, v TEXT)");
+        writer.execute("INSERT INTO t VALUES (1, 'old'), (2, 'x')");
+
+        auto db = open();
+        auto reader = db.open_point_reader("t", "v");
+        std::string value;
+        CHECK(reader.read(1, value) && value == "old");
+
+        writer.execute("UPDATE t SET v = 'new' WHERE id = 1");
+        CHECK(reader.read(1, value) && value == "new");
+        CHECK(!reader.read(3, value));
+        remove_database();
+    }
+
+    void no_read_transaction_left_open()
+    {
+        remove_database();
+        auto writer = open();
+        writer.execute("CREATE TABLE t(id INTEGER PRIMARY KEY, v TEXT)");
+        writer.execute("INSERT INTO t VALUES (1, 'a')");
+
+        auto db = open();
+        auto reader = db.open_point_reader("t", "v");
+        std::string value;
+        CHECK(reader.read(1, value));
+
+        writer.execute("INSERT INTO t VALUES (2, 'b')");
+        int busy = -1;
+        writer.execute("PRAGMA wal_checkpoint(TRUNCATE)").fetch(busy);
+        CHECK(busy == 0);
+
+        // inside a transaction the handle is kept, after it the next read sees newer commits
+        db.begin();
+        CHECK(reader.read(1, value) && reader.read(2, value) && value == "b");
+        db.commit();
+        writer.execute("UPDATE t SET v = 'c' WHERE id = 2");
+        CHECK(reader.read(2, value) && value == "c");
+        remove_database();
+    }
+}
+
+int main()
+{
+    return test::run({
+        {"reads_see_other_commits", reads_see_other_commits},
+        {"no_read_transaction_left_open", no_read_transaction_left_open},
+    });
+}
@@ -0,0 +1,71 @@
+#include <sqlite3_wrapper/sqlite3_shared_memory.h>
+
+#include "test.h"
+
+namespace sqlite = sqlite3_wrapper;
+namespace test = sqlite3_wrapper_test;
+
+namespace
+{
+    int64_t count(sqlite::db &db)
+    {
+        int64_t count = 0;
+        db.execute("SELECT COUNT(*) FROM t").fetch(count);
+
+        return count;
+    }
+
+    void names_with_uri_characters()
+    {
+        sqlite::shared_memory_db a("a?b#c%d");
+        sqlite::shared_memory_db b("a");
+        a.anchor().execute("CREATE TABLE t(v INTEGER)");
+        a.anchor().execute("INSERT INTO t VALUES (1)");
+
+        auto connection = a.connect();
+        CHECK(count(connection) == 1);
+        // in memory, not a file named "a" with the rest of the name parsed as URI parameters
+        CHECK(std::string(sqlite3_db_filename(connection.native_handle(), "main")).empty());
+
+        // "a?b#c%d" must not be cut to the database named "a"
+        bool missing = false;
+        try
+        {
+            count(b.anchor());
+        }
+        catch (const sqlite::exception &)
+        {
+            missing = true;
+        }
+        CHECK(missing);
+    }
+
+    void caches_sharing_a_name()
+    {
+        sqlite::shared_memory_cache first("cache");
+        sqlite::shared_memory_cache second("cache");
+        first.refresh([](sqlite::db &db)
+        {
+            db.execute("CREATE TABLE t(v INTEGER)");
+            db.execute("INSERT INTO t VALUES (1), (2)");
+        });
+        second.refresh([](sqlite::db &db)
+        {
+            db.execute("CREATE TABLE t(v INTEGER)");
+            db.execute("INSERT INTO t VALUES (1)");
+        });
+
+        auto first_reader = first.make_reader();
+        auto second_reader = second.make_reader();
+        CHECK(count(first_reader.connection()) == 2);
+        CHECK(count(second_reader.connection()) == 1);
+    }
+}
+
+int main()
+{
+    return test::run({
+        {"names_with_uri_characters", names_with_uri_characters},
+        {"caches_sharing_a_name", caches_sharing_a_name},
+    });
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sqlite3_wrapper_test
+{
+    using test_case = std::pair<std::string, std::function<void()>>;
+
+    inline void check(bool condition, const char *expression, const char *file, int line)
+    {
+        if (!condition)
+        {
+            throw std::runtime_error(std::string(file) + ":" + std::to_string(line) + ": " + expression);
+        }
+    }
+
+    // Runs the test cases, prints the failures and returns the exit code
+    inline int run(const std::vector<test_case> &cases)
+    {
+        int failed = 0;
+        for (const auto &test : cases)
+        {
+            try
+            {
+                test.second();
+                std::printf("ok     %s\n", test.first.c_str());
+            }
+            catch (const std::exception &e)
+            {
+                ++failed;
+                std::printf("FAILED %s: %s\n", test.first.c_str(), e.what());
+            }
+        }
+
+        return failed ? 1 : 0;
+    }
+}
+
+#define CHECK(condition) sqlite3_wrapper_test::check((condition), #condition, __FILE__, __LINE__)
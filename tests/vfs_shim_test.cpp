@@ -0,0 +1,113 @@
+#include <sqlite3_wrapper/sqlite3_warmup.h>
+
+#include "test.h"
+
+#include <cstdio>
+
+namespace sqlite = sqlite3_wrapper;
+namespace test = sqlite3_wrapper_test;
+
+namespace
+{
+    const std::string filename = "vfs_shim_test.db";
+
+    class throwing_shim : public sqlite::vfs_shim
+    {
+    public:
+        throwing_shim()
+            : vfs_shim("throwing_shim")
+        {
+        }
+
+        bool throw_on_open = false;
+        bool throw_on_read = false;
+
+    protected:
+        void opened(sqlite::vfs_file &file, const char *) override
+        {
+            if (throw_on_open && (file.flags & SQLITE_OPEN_MAIN_DB))
+            {
+                throw std::runtime_error("opened failed");
+            }
+        }
+
+        int read(sqlite::vfs_file &file, void *data, int amount, sqlite3_int64 offset) override
+        {
+            if (throw_on_read)
+            {
+                throw std::bad_alloc();
+            }
+
+            return vfs_shim::read(file, data, amount, offset);
+        }
+    };
+
+    int error_code(const std::function<void()> &f)
+    {
+        try
+        {
+            f();
+        }
+        catch (const sqlite::exception &e)
+        {
+            return e.code();
+        }
+
+        return SQLITE_OK;
+    }
+
+    void exceptions_fail_operations()
+    {
+        std::remove(filename.c_str());
+        {
+            sqlite::db db(filename);
+            db.execute("CREATE TABLE items(id INTEGER PRIMARY KEY)");
+        }
+
+        throwing_shim shim;
+        shim.throw_on_open = true;
+        CHECK(error_code([&shim] { sqlite::db db(filename, SQLITE_OPEN_READWRITE, shim.name().c_str()); }) == SQLITE_CANTOPEN);
+
+        shim.throw_on_open = false;
+        sqlite::db db(filename, SQLITE_OPEN_READWRITE, shim.name().c_str());
+        shim.throw_on_read = true;
+        CHECK(error_code([&db] { db.execute("SELECT count(*) FROM items"); }) == SQLITE_NOMEM);
+
+        shim.throw_on_read = false;
+        int64_t count = -1;
+        db.execute("SELECT count(*) FROM items").fetch(count);
+        CHECK(count == 0);
+    }
+
+    void interior_pages_quotes_schema()
+    {
+        sqlite::db db(":memory:");
+        db.execute("ATTACH ':memory:' AS \"odd\"\"schema\"");
+        db.execute("CREATE TABLE \"odd\"\"schema\".items(id INTEGER PRIMARY KEY)");
+
+        auto pages = sqlite::interior_pages(db, "odd\"schema");
+        CHECK(pages.size() == 1);
+
+        bool thrown = false;
+        try
+        {
+            sqlite::interior_pages(db, "missing");
+        }
+        catch (const sqlite::exception &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+}
+
+int main()
+{
+    auto result = test::run({
+        {"exceptions_fail_operations", exceptions_fail_operations},
+        {"interior_pages_quotes_schema", interior_pages_quotes_schema},
+    });
+    std::remove(filename.c_str());
+
+    return result;
+}
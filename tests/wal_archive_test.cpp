@@ -0,0 +1,117 @@
+#include <sqlite3_wrapper/sqlite3_wal_archive.h>
+
+#include "test.h"
+
+#include <cstdio>
+
+namespace sqlite = sqlite3_wrapper;
+namespace test = sqlite3_wrapper_test;
+
+namespace
+{
+    const std::string filename = "wal_archive_test.db";
+    const std::string standby_filename = "wal_archive_test_standby.db";
+    const std::string shipper_directory = "wal_archive_test_batches";
+    const std::string archive_directory = "wal_archive_test_archive";
+
+    void remove_files()
+    {
+        for (const auto &name : {filename, standby_filename})
+        {
+            std::remove(name.c_str());
+            std::remove((name + "-wal").c_str());
+            std::remove((name + "-shm").c_str());
+        }
+        std::filesystem::remove_all(shipper_directory);
+        std::filesystem::remove_all(archive_directory);
+    }
+
+    sqlite::db create_primary()
+    {
+        remove_files();
+        sqlite::db db(filename);
+        db.execute("PRAGMA journal_mode = WAL");
+        db.execute("CREATE TABLE items(id INTEGER PRIMARY KEY, value INTEGER NOT NULL)");
+
+        return db;
+    }
+
+    void insert(sqlite::db &db, int id)
+    {
+        db.execute("INSERT INTO items VALUES (?, ?)", id, id * 10);
+    }
+
+    void applier_keeps_batches_until_archived()
+    {
+        {
+            auto db = create_primary();
+            sqlite::wal_shipper shipper(db, shipper_directory);
+            sqlite::wal_archive archive(archive_directory);
+            archive.attach(shipper);
+
+            sqlite::db standby(standby_filename);
+            sqlite::replica_applier applier(standby, shipper_directory);
+
+            insert(db, 1);
+            // a directory in place of its temporary file fails the next appends, the applier runs in between
+            auto blocker = std::filesystem::path(archive_directory) / (sqlite::detail::segment_name(2) + ".tmp");
+            std::filesystem::create_directory(blocker);
+            insert(db, 2);
+            insert(db, 3);
+            CHECK(archive.sequence() == 1);
+            CHECK(shipper.last_error() != nullptr);
+            CHECK(applier.apply() == 3);
+            std::filesystem::remove(blocker);
+
+            insert(db, 4);
+            applier.apply();
+
+            CHECK(shipper.last_error() == nullptr);
+            CHECK(archive.sequence() == 4);
+            CHECK(archive.restore("wal_archive_test_restored.db", 4) == 4);
+            sqlite::db restored("wal_archive_test_restored.db");
+            int64_t count = 0;
+            restored.execute("SELECT count(*) FROM items").fetch(count);
+            CHECK(count == 4);
+        }
+        std::remove("wal_archive_test_restored.db");
+        remove_files();
+    }
+
+    void late_attach_fails_on_pruned_batches()
+    {
+        {
+            auto db = create_primary();
+            sqlite::wal_shipper shipper(db, shipper_directory);
+            sqlite::db standby(standby_filename);
+            sqlite::replica_applier applier(standby, shipper_directory);
+
+            insert(db, 1);
+            insert(db, 2);
+            applier.apply();
+
+            sqlite::wal_archive archive(archive_directory);
+            bool thrown = false;
+            try
+            {
+                archive.attach(shipper);
+            }
+            catch (const std::runtime_error &)
+            {
+                thrown = true;
+            }
+            CHECK(thrown);
+            // a failed attach does not stop the applier from pruning
+            CHECK(!std::filesystem::exists(std::filesystem::path(shipper_directory) / sqlite::detail::archived_name));
+        }
+        remove_files();
+    }
+}
+
+int main()
+{
+    return test::run({
+        {"applier_keeps_batches_until_archived", applier_keeps_batches_until_archived},
+        {"late_attach_fails_on_pruned_batches", late_attach_fails_on_pruned_batches},
+    });
+}
@@ -0,0 +1,89 @@
+#include <sqlite3_wrapper/sqlite3_workload_log.h>
+
+#include "test.h"
+
+#include <cstdio>
+
+namespace sqlite = sqlite3_wrapper;
+namespace test = sqlite3_wrapper_test;
+
+namespace
+{
+    const std::string filename = "workload_log_test.log";
+
+    std::vector<sqlite::workload_execution> executions()
+    {
+        std::vector<sqlite::workload_execution> executions;
+        sqlite::workload_log_reader reader(filename);
+        sqlite::workload_execution execution;
+        while (reader.next(execution))
+        {
+            executions.push_back(execution);
+        }
+
+        return executions;
+    }
+
+    void exact_parameters()
+    {
+        sqlite::db db(":memory:");
+        db.execute("CREATE TABLE t(i INTEGER, r REAL, s TEXT, n)");
+        {
+            sqlite::workload_log log(filename);
+            log.attach(db);
+
+            auto insert_statement = db.prepare("INSERT INTO t VALUES (?, ?, ?, ?)");
+            insert_statement.execute(int64_t(-7), 0.1 + 0.2, std::string("a\0b", 3), nullptr);
+            insert_statement.execute(int64_t(1), 1e300, "plain", boost::optional<int>());
+            log.detach(db);
+        }
+
+        auto recorded = executions();
+        CHECK(recorded.size() == 2);
+        auto &first = recorded[0].parameters;
+        CHECK(first.size() == 4);
+        CHECK(first[0].type == SQLITE_INTEGER && first[0].integer == -7);
+        CHECK(first[1].type == SQLITE_FLOAT && first[1].real == 0.1 + 0.2);
+        CHECK(first[2].type == SQLITE_TEXT && first[2].bytes == std::string("a\0b", 3));
+        CHECK(first[3].type == SQLITE_NULL);
+
+        auto &second = recorded[1].parameters;
+        CHECK(second[1].real == 1e300 && second[2].bytes == "plain" && second[3].type == SQLITE_NULL);
+        std::remove(filename.c_str());
+    }
+
+    void raw_bindings_use_expanded_sql()
+    {
+        sqlite::db db(":memory:");
+        db.execute("CREATE TABLE t(v)");
+        {
+            sqlite::workload_log log(filename);
+            log.attach(db);
+
+            auto insert_statement = db.prepare("INSERT INTO t VALUES (?)");
+            insert_statement.execute(std::string("wrapper"));
+
+            // bound around the wrapper, the value recorded for the previous execution must not be reused
+            auto native = insert_statement.native_handle();
+            sqlite3_reset(native);
+            sqlite3_bind_text(native, 1, "raw", -1, SQLITE_STATIC);
+            sqlite3_step(native);
+            sqlite3_reset(native);
+            log.detach(db);
+        }
+
+        auto recorded = executions();
+        CHECK(recorded.size() == 2);
+        CHECK(recorded[0].parameters[0].bytes == "wrapper");
+        CHECK(recorded[1].parameters[0].bytes == "raw");
+        std::remove(filename.c_str());
+    }
+}
+
+int main()
+{
+    return test::run({
+        {"exact_parameters", exact_parameters},
+        {"raw_bindings_use_expanded_sql", raw_bindings_use_expanded_sql},
+    });
+}
@@ -0,0 +1,142 @@
+#include <sqlite3_wrapper/sqlite3_workload.h>
+
+extern "C"
+{
+#include <sqlite3expert.h>
+}
+
+#include <algorithm>
+#include <cstdio>
+#include <set>
+#include <sstream>
+
+namespace sqlite = sqlite3_wrapper;
+
+namespace
+{
+    struct recommendation
+    {
+        std::string index;
+        size_t statements = 0;
+        uint64_t calls = 0;
+        uint64_t time_ns = 0;
+    };
+
+    struct expert_deleter
+    {
+        void operator()(sqlite3expert *expert) const
+        {
+            sqlite3_expert_destroy(expert);
+        }
+    };
+
+    std::string take_error(char *error)
+    {
+        std::string message = error ? error : "unknown error";
+        sqlite3_free(error);
+
+        return message;
+    }
+}
+
+// Usage: index_advisor <database> <workload> [sample percent]
+// The workload is saved by sqlite3_wrapper::workload_recorder. Statements are analyzed by sqlite3expert
+// against a copy of the database schema, recommended indexes are ordered by recorded time of statements they serve.
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::fprintf(stderr, "usage: %s <database> <workload> [sample percent]\n", argv[0]);
+        return 2;
+    }
+
+    try
+    {
+        sqlite::db db(argv[1], SQLITE_OPEN_READONLY);
+        auto workload = sqlite::workload_recorder::load(argv[2]);
+
+        char *error = nullptr;
+        std::unique_ptr<sqlite3expert, expert_deleter> expert(sqlite3_expert_new(db.native_handle(), &error));
+        if (!expert)
+        {
+            throw std::runtime_error(take_error(error));
+        }
+
+        if (argc > 3)
+        {
+            sqlite3_expert_config(expert.get(), EXPERT_CONFIG_SAMPLE, std::atoi(argv[3]));
+        }
+
+        // report indexes of sqlite3expert follow the order of accepted statements
+        std::vector<const sqlite::workload_entry *> accepted;
+        for (const auto &entry : workload)
+        {
+            if (sqlite3_expert_sql(expert.get(), entry.sql.c_str(), &error) != SQLITE_OK)
+            {
+                std::fprintf(stderr, "-- skipped: %s\n--   %s\n", take_error(error).c_str(), entry.sql.c_str());
+                error = nullptr;
+                continue;
+            }
+            accepted.push_back(&entry);
+        }
+
+        if (sqlite3_expert_analyze(expert.get(), &error) != SQLITE_OK)
+        {
+            throw std::runtime_error(take_error(error));
+        }
+
+        std::map<std::string, recommendation> recommendations;
+        for (int i = 0; i < sqlite3_expert_count(expert.get()); ++i)
+        {
+            auto indexes = sqlite3_expert_report(expert.get(), i, EXPERT_REPORT_INDEXES);
+            if (!indexes)
+            {
+                continue;
+            }
+
+            std::istringstream lines(indexes);
+            std::string index;
+            while (std::getline(lines, index))
+            {
+                if (index.compare(0, 6, "CREATE") != 0)
+                {
+                    continue;
+                }
+
+                auto &r = recommendations[index];
+                r.index = index;
+                ++r.statements;
+                r.calls += accepted[static_cast<size_t>(i)]->calls;
+                r.time_ns += accepted[static_cast<size_t>(i)]->time_ns;
+            }
+        }
+
+        std::vector<recommendation> sorted;
+        for (const auto &r : recommendations)
+        {
+            sorted.push_back(r.second);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const recommendation &a, const recommendation &b)
+        {
+            return a.time_ns > b.time_ns;
+        });
+
+        if (sorted.empty())
+        {
+            std::printf("-- no new indexes recommended for %zu statements\n", accepted.size());
+        }
+
+        for (const auto &r : sorted)
+        {
+            std::printf("-- benefits %zu statements, %llu calls, %.3f ms recorded\n%s\n\n", r.statements,
+                static_cast<unsigned long long>(r.calls), r.time_ns / 1e6, r.index.c_str());
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <sqlite3_wrapper/sqlite3_wal_archive.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+namespace sqlite = sqlite3_wrapper;
+
+// Usage: pitr_restore <archive> --list
+//        pitr_restore <archive> <new database> [--sequence N | --time YYYY-MM-DDTHH:MM:SS[.fff]] [--threads N]
+// Restores the database of a wal_archive as of a segment or of a UTC time, by default as of the last segment.
+namespace
+{
+    std::string format_time(int64_t time_ns)
+    {
+        auto seconds = static_cast<std::time_t>(time_ns / 1000000000);
+        std::tm tm;
+        gmtime_r(&seconds, &tm);
+
+        char text[40];
+        auto size = std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &tm);
+        std::snprintf(text + size, sizeof(text) - size, ".%03d", static_cast<int>(time_ns / 1000000 % 1000));
+
+        return text;
+    }
+
+    bool parse_time(const char *text, int64_t &time_ns)
+    {
+        std::tm tm = {};
+        double seconds = 0;
+        if (std::sscanf(text, "%d-%d-%dT%d:%d:%lf", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &seconds) != 6)
+        {
+            return false;
+        }
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+
+        time_ns = static_cast<int64_t>(timegm(&tm)) * 1000000000 + static_cast<int64_t>(seconds * 1e9);
+        return true;
+    }
+
+    int usage()
+    {
+        std::fprintf(stderr, "usage: pitr_restore <archive> --list\n"
+            "       pitr_restore <archive> <new database> [--sequence N | --time YYYY-MM-DDTHH:MM:SS[.fff]] [--threads N]\n");
+        return 2;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        return usage();
+    }
+
+    try
+    {
+        sqlite::wal_archive archive(argv[1]);
+        if (std::string(argv[2]) == "--list")
+        {
+            for (const auto &segment : archive.segments())
+            {
+                std::printf("%llu %s\n", static_cast<unsigned long long>(segment.sequence), format_time(segment.committed_at).c_str());
+            }
+            return 0;
+        }
+
+        auto sequence = archive.sequence();
+        auto threads = std::thread::hardware_concurrency();
+        for (int i = 3; i + 1 < argc; i += 2)
+        {
+            std::string arg = argv[i];
+            if (arg == "--sequence")
+            {
+                sequence = std::strtoull(argv[i + 1], nullptr, 10);
+            }
+            else if (arg == "--time")
+            {
+                int64_t time_ns;
+                if (!parse_time(argv[i + 1], time_ns))
+                {
+                    return usage();
+                }
+                sequence = archive.sequence_at(time_ns);
+            }
+            else if (arg == "--threads")
+            {
+                threads = static_cast<unsigned int>(std::max(1, std::atoi(argv[i + 1])));
+            }
+            else
+            {
+                return usage();
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto applied = archive.restore(argv[2], sequence, threads);
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::printf("restored %s as of segment %llu (%zu segments) in %.3f s\n", argv[2], static_cast<unsigned long long>(sequence), applied, elapsed);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
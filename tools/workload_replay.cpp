@@ -0,0 +1,248 @@
+#include <sqlite3_wrapper/sqlite3_workload_log.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <thread>
+
+namespace sqlite = sqlite3_wrapper;
+
+namespace
+{
+    struct options
+    {
+        std::string log;
+        std::string database;
+        // 0 replays as fast as possible, 1 at the original pace, 2 twice as fast
+        double speed = 0;
+        // 0 gives every recorded connection its own thread
+        unsigned int threads = 0;
+    };
+
+    // Replay connection of a recorded connection with its statements prepared on first use
+    struct replay_connection
+    {
+        std::unique_ptr<sqlite::db> db;
+        std::vector<std::unique_ptr<sqlite::statement>> prepared;
+    };
+
+    void bind(sqlite3_stmt *statement, const std::vector<sqlite::workload_value> &parameters)
+    {
+        int index = 1;
+        for (const auto &value : parameters)
+        {
+            switch (value.type)
+            {
+            case SQLITE_INTEGER:
+                sqlite3_bind_int64(statement, index, value.integer);
+                break;
+            case SQLITE_FLOAT:
+                sqlite3_bind_double(statement, index, value.real);
+                break;
+            case SQLITE_TEXT:
+                sqlite3_bind_text(statement, index, value.bytes.data(), static_cast<int>(value.bytes.size()), SQLITE_STATIC);
+                break;
+            case SQLITE_BLOB:
+                sqlite3_bind_blob(statement, index, value.bytes.data(), static_cast<int>(value.bytes.size()), SQLITE_STATIC);
+                break;
+            default:
+                sqlite3_bind_null(statement, index);
+                break;
+            }
+            ++index;
+        }
+    }
+
+    uint64_t percentile(const std::vector<uint64_t> &sorted, double p)
+    {
+        if (sorted.empty())
+        {
+            return 0;
+        }
+
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+    }
+
+    void report(const char *name, std::vector<uint64_t> latencies)
+    {
+        std::sort(latencies.begin(), latencies.end());
+        std::printf("%-10s p50 %9.1f us  p90 %9.1f us  p99 %9.1f us  p99.9 %9.1f us  max %9.1f us\n", name,
+            percentile(latencies, 0.5) / 1e3, percentile(latencies, 0.9) / 1e3, percentile(latencies, 0.99) / 1e3,
+            percentile(latencies, 0.999) / 1e3, latencies.empty() ? 0.0 : latencies.back() / 1e3);
+    }
+}
+
+// Usage: workload_replay <log> <database copy> [--speed X] [--threads N]
+// Replays a log written by sqlite3_wrapper::workload_log. Every recorded connection is replayed on its own connection
+// by one thread, keeping the order of its executions; recorded connections are spread over N threads. Connections
+// sharing a thread can not wait for each other's locks, so a write blocked by another connection of the same
+// thread fails after the busy timeout.
+int main(int argc, char *argv[])
+{
+    options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--speed" && i + 1 < argc)
+        {
+            options.speed = std::atof(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            options.threads = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (options.log.empty())
+        {
+            options.log = arg;
+        }
+        else
+        {
+            options.database = arg;
+        }
+    }
+
+    if (options.log.empty() || options.database.empty())
+    {
+        std::fprintf(stderr, "usage: %s <log> <database copy> [--speed X] [--threads N]\n", argv[0]);
+        return 2;
+    }
+
+    try
+    {
+        sqlite::workload_log_reader reader(options.log);
+
+        std::vector<sqlite::workload_execution> executions;
+        sqlite::workload_execution execution;
+        std::map<uint32_t, unsigned int> connection_order;
+        while (reader.next(execution))
+        {
+            connection_order.emplace(execution.connection, static_cast<unsigned int>(connection_order.size()));
+            executions.push_back(execution);
+        }
+        const auto &statements = reader.statements();
+        const auto total = executions.size();
+
+        // recorded connections are pinned to threads round robin in the order they first appear
+        if (options.threads == 0 || options.threads > connection_order.size())
+        {
+            options.threads = static_cast<unsigned int>(std::max<size_t>(1, connection_order.size()));
+        }
+        std::vector<std::vector<sqlite::workload_execution>> queues(options.threads);
+        for (auto &e : executions)
+        {
+            queues[connection_order[e.connection] % options.threads].push_back(std::move(e));
+        }
+
+        std::vector<uint64_t> recorded;
+        std::vector<std::vector<uint64_t>> replayed(options.threads);
+        std::atomic<size_t> errors(0);
+        std::mutex failure_mutex;
+        std::string failure;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < options.threads; ++t)
+        {
+            workers.emplace_back([&, t]
+            {
+                std::map<uint32_t, replay_connection> connections;
+                try
+                {
+                    for (const auto &e : queues[t])
+                    {
+                        auto &connection = connections[e.connection];
+                        if (!connection.db)
+                        {
+                            connection.db.reset(new sqlite::db(options.database, sqlite::threading_mode::MULTI_THREAD));
+                            connection.db->execute("PRAGMA busy_timeout = 10000");
+                            connection.prepared.resize(statements.size());
+                        }
+                    }
+                }
+                catch (const std::exception &e)
+                {
+                    std::lock_guard<std::mutex> lock(failure_mutex);
+                    failure = e.what();
+                    return;
+                }
+
+                for (const auto &e : queues[t])
+                {
+                    if (options.speed > 0)
+                    {
+                        std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<int64_t>(e.start_us / options.speed)));
+                    }
+
+                    try
+                    {
+                        auto &connection = connections[e.connection];
+                        auto &statement = connection.prepared[e.statement];
+                        if (!statement)
+                        {
+                            statement.reset(new sqlite::statement(connection.db->prepare(statements[e.statement])));
+                        }
+
+                        auto begin = std::chrono::steady_clock::now();
+                        auto native = statement->native_handle();
+                        sqlite3_reset(native);
+                        bind(native, e.parameters);
+
+                        int res;
+                        while ((res = sqlite3_step(native)) == SQLITE_ROW)
+                        {
+                        }
+                        sqlite3_reset(native);
+                        replayed[t].push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count()));
+
+                        if (res != SQLITE_DONE)
+                        {
+                            ++errors;
+                        }
+                    }
+                    catch (const sqlite::exception &)
+                    {
+                        ++errors;
+                    }
+                }
+            });
+        }
+
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!failure.empty())
+        {
+            throw std::runtime_error("failed to open " + options.database + ": " + failure);
+        }
+
+        for (const auto &queue : queues)
+        {
+            for (const auto &e : queue)
+            {
+                recorded.push_back(e.duration_ns);
+            }
+        }
+
+        std::vector<uint64_t> all;
+        for (const auto &latencies : replayed)
+        {
+            all.insert(all.end(), latencies.begin(), latencies.end());
+        }
+
+        std::printf("%zu connections on %u threads\n", connection_order.size(), options.threads);
+        std::printf("%zu executions of %zu statements, %zu errors, %.3f s, %.0f executions/s\n", total, statements.size(), errors.load(), elapsed, total / elapsed);
+        report("recorded", recorded);
+        report("replayed", all);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}